@@ -0,0 +1,368 @@
+/**
+ * In-process microbenchmark of all the kernel variants, see 'make bench'.
+ *
+ * Unlike 'tests/performance.py', which starts the program for each size and reads milliseconds including the file I/O,
+ * the kernels are called repeatedly on data in memory and timed with nanosecond resolution. Each measurement is preceded
+ * by a warm-up call, short calls are timed in batches, so the clock overhead is negligible, and the median of the
+ * repetitions is reported. The throughput of the array kernels is compared with a plain vectorized sum of the same data,
+ * i.e. with the read bandwidth of the memory level the data fit in.
+ *
+ * Usage: bench [--format csv|json] [--max-power N] [--min-time-ms T] [-o path]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+#include <omp.h>
+
+#include "../src/AlignedAllocator.hpp"
+#include "../src/INode.h"
+#include "../src/assignment.h"
+#include "../src/dispatch.h"
+#include "../src/kernels.h"
+
+using namespace std;
+
+namespace
+{
+    constexpr size_t MIN_REPETITIONS = 5;
+    constexpr size_t MAX_REPETITIONS = 1000;
+    constexpr double MIN_BATCH_NANOSECONDS = 20000; // calls shorter than this are timed in batches
+
+    struct Result
+    {
+        string benchmark;
+        string kernel;
+        size_t elements;
+        size_t bytes;          // bytes read by a call, i.e. the size of the data
+        size_t repetitions;
+        double nanoseconds;    // median time of a call
+        double bandwidthGBs;   // read bandwidth measured on the same data, 0 when not applicable
+    };
+
+    /**
+     * Keeps the compiler from removing a call, whose result is not used.
+     */
+    template<typename T>
+    inline void keep(const T& value)
+    {
+        asm volatile("" : : "r"(&value) : "memory");
+    }
+
+    /**
+     * Returns the median time of a call of 'function' in nanoseconds and the number of the timed repetitions.
+     */
+    template<typename FUNCTION>
+    pair<double, size_t> measure(FUNCTION function, double minNanoseconds)
+    {
+        using clock = chrono::steady_clock;
+        auto elapsed = [](clock::time_point start) { return chrono::duration<double, nano>(clock::now() - start).count(); };
+
+        function(); // warm-up, i.e. page faults, caches, branch predictors and the threads of OpenMP
+
+        size_t batch = 1; // number of calls timed at once
+        while (true)
+        {
+            auto start = clock::now();
+            for (size_t i = 0; i < batch; i++)
+            {
+                function();
+            }
+            if (elapsed(start) >= MIN_BATCH_NANOSECONDS)
+            {
+                break;
+            }
+            batch *= 2;
+        }
+
+        vector<double> times;
+        auto begin = clock::now();
+        while (times.size() < MAX_REPETITIONS && (times.size() < MIN_REPETITIONS || elapsed(begin) < minNanoseconds))
+        {
+            auto start = clock::now();
+            for (size_t i = 0; i < batch; i++)
+            {
+                function();
+            }
+            times.push_back(elapsed(start) / batch);
+        }
+        nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+        return { times[times.size() / 2], times.size() * batch };
+    }
+
+    /**
+     * Reference of the read bandwidth, a parallel sum of the data, which has nothing to do but to read them.
+     */
+    __attribute__((target_clones("avx512f", "avx2", "default")))
+    int64_t readAll(const int *data, size_t size)
+    {
+        int64_t sum = 0;
+        #pragma omp parallel for reduction(+:sum) schedule(static)
+        for (size_t i = 0; i < size; i++)
+        {
+            sum += data[i];
+        }
+        return sum;
+    }
+
+    /**
+     * Measures the kernels of another element type than 'int' on the same bytes, i.e. on more or fewer elements.
+     */
+    template <typename T>
+    void measureElements(const KernelSet& kernelSet, const string& typeName, const int *input, size_t bytes, double bandwidth,
+                         double minNanoseconds, vector<Result>& results)
+    {
+        const T *elements = reinterpret_cast<const T *>(input);
+        size_t size = bytes / sizeof(T);
+        const ElementKernels<T>& kernels = kernelSet.elementKernels<T>();
+        auto [closestNs, closestRepetitions] = measure([&] { keep(kernels.getClosestToZero(elements, size)); }, minNanoseconds);
+        results.push_back({ "getClosestToZero<" + typeName + ">", kernelSet.name, size, bytes, closestRepetitions, closestNs, bandwidth });
+        auto [chunksNs, chunksRepetitions] = measure([&] { keep(kernels.countChunks(elements, size)); }, minNanoseconds);
+        results.push_back({ "countChunks<" + typeName + ">", kernelSet.name, size, bytes, chunksRepetitions, chunksNs, bandwidth });
+    }
+
+    /**
+     * Tree with random numbers of children, the same shape as a trie of random words, but much smaller nodes.
+     */
+    class BenchNode : public INode
+    {
+    public:
+        BenchNode(int value) : _value{value} {}
+
+        int value() const override { return _value; }
+        const vector<unique_ptr<INode>>& children() const override { return _children; }
+
+        vector<unique_ptr<INode>> _children;
+
+    private:
+        int _value;
+    };
+
+    /**
+     * Builds a tree of 'nodeCount' nodes breadth-first, each node has 0 to 7 children, returns the root and the number of levels.
+     */
+    pair<unique_ptr<BenchNode>, size_t> buildTree(size_t nodeCount, mt19937& random)
+    {
+        uniform_int_distribution<int> values(-128, 127);
+        uniform_int_distribution<size_t> childCounts(0, 7);
+        auto root = make_unique<BenchNode>(0);
+        vector<BenchNode *> level{ root.get() };
+        size_t levelCount = 1;
+        for (size_t created = 1; created < nodeCount && !level.empty(); levelCount++)
+        {
+            vector<BenchNode *> nextLevel;
+            for (BenchNode *node : level)
+            {
+                // a node without children at the start of a level could end the tree, so the first one has some
+                size_t childCount = min(node == level.front() ? 4 : childCounts(random), nodeCount - created);
+                for (size_t i = 0; i < childCount; i++)
+                {
+                    node->_children.push_back(make_unique<BenchNode>(values(random)));
+                    nextLevel.push_back(static_cast<BenchNode *>(node->_children.back().get()));
+                }
+                created += childCount;
+            }
+            level = move(nextLevel);
+        }
+        return { move(root), levelCount };
+    }
+
+    void writeCSV(ostream& output, const vector<Result>& results)
+    {
+        output << "benchmark,kernel,threads,elements,bytes,repetitions,ns,ns_per_element,gb_per_s,bandwidth_gb_per_s,bandwidth_fraction\n";
+        for (const Result& result : results)
+        {
+            double gbs = result.bytes / result.nanoseconds; // bytes per nanosecond are GB/s
+            output << result.benchmark << "," << result.kernel << "," << omp_get_max_threads() << "," << result.elements << ","
+                   << result.bytes << "," << result.repetitions << "," << fixed << setprecision(1) << result.nanoseconds << ","
+                   << setprecision(4) << result.nanoseconds / result.elements << "," << gbs << ","
+                   << result.bandwidthGBs << "," << (result.bandwidthGBs > 0 ? gbs / result.bandwidthGBs : 0.0) << "\n";
+        }
+    }
+
+    void writeJSON(ostream& output, const vector<Result>& results)
+    {
+        output << "{\n  \"threads\": " << omp_get_max_threads() << ",\n  \"active_kernel\": \"" << activeKernelSet().name << "\",\n  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const Result& result = results[i];
+            double gbs = result.bytes / result.nanoseconds;
+            output << "    { \"benchmark\": \"" << result.benchmark << "\", \"kernel\": \"" << result.kernel << "\", \"elements\": "
+                   << result.elements << ", \"bytes\": " << result.bytes << ", \"repetitions\": " << result.repetitions
+                   << fixed << setprecision(1) << ", \"ns\": " << result.nanoseconds << setprecision(4)
+                   << ", \"ns_per_element\": " << result.nanoseconds / result.elements << ", \"gb_per_s\": " << gbs
+                   << ", \"bandwidth_gb_per_s\": " << result.bandwidthGBs
+                   << ", \"bandwidth_fraction\": " << (result.bandwidthGBs > 0 ? gbs / result.bandwidthGBs : 0.0)
+                   << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        output << "  ]\n}\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    struct
+    {
+        string format = "csv";
+        size_t maxPower = 24;    // the largest arrays have 2^maxPower elements
+        double minTimeMs = 100;  // minimal time of the repetitions of a measurement
+        string outputPath;       // the standard output, when empty
+    } parsedArgs;
+
+    vector<string> args(argv, argv + argc);
+    for (size_t i = 1; i < args.size(); i++)
+    {
+        try
+        {
+            bool hasValue = i + 1 < args.size();
+            if (args[i] == "--format" && hasValue)
+            {
+                i++;
+                if (args[i] != "csv" && args[i] != "json")
+                {
+                    throw invalid_argument(args[i]);
+                }
+                parsedArgs.format = args[i];
+            }
+            else if (args[i] == "--max-power" && hasValue)
+            {
+                i++;
+                parsedArgs.maxPower = stoul(args[i]);
+                if (parsedArgs.maxPower < 10 || parsedArgs.maxPower > 30)
+                {
+                    throw out_of_range(args[i]);
+                }
+            }
+            else if (args[i] == "--min-time-ms" && hasValue)
+            {
+                i++;
+                parsedArgs.minTimeMs = stod(args[i]);
+            }
+            else if (args[i] == "-o" && hasValue)
+            {
+                i++;
+                parsedArgs.outputPath = args[i];
+            }
+            else
+            {
+                throw invalid_argument(args[i]); // a switch without its value, or an unknown one
+            }
+        }
+        catch (const logic_error& e) // both 'invalid_argument' and 'out_of_range', also of 'stoul' and 'stod'
+        {
+            cerr << "Error: Invalid argument '" << args[i] << "', usage: bench [--format csv|json] [--max-power 10..30] [--min-time-ms T] [-o path]." << endl;
+            exit(-1);
+        }
+    }
+
+    double minNanoseconds = parsedArgs.minTimeMs * 1e6;
+    mt19937 random(42);
+    vector<Result> results;
+
+    // the same values as in 'tests/performance.py'
+    size_t maxSize = size_t{1} << parsedArgs.maxPower;
+    unique_ptr<int[], AlignedAllocator<int>::Deleter> data(AlignedAllocator<int>{}.allocate(maxSize));
+    uniform_int_distribution<int> values(-(1 << 20), (1 << 20) - 1);
+    generate(data.get(), data.get() + maxSize, [&] { return values(random); });
+
+    for (size_t power = 10; power <= parsedArgs.maxPower; power += 2)
+    {
+        size_t size = size_t{1} << power;
+        size_t bytes = size * sizeof(int);
+        const int *input = data.get();
+
+        auto [readNs, readRepetitions] = measure([&] { keep(readAll(input, size)); }, minNanoseconds);
+        double bandwidth = bytes / readNs;
+        results.push_back({ "read", "reference", size, bytes, readRepetitions, readNs, bandwidth });
+
+        for (const KernelSet& kernelSet : kernelSets())
+        {
+            if (!kernelSet.isSupported())
+            {
+                continue;
+            }
+            auto [closestNs, closestRepetitions] = measure([&] { keep(kernelSet.getClosestToZero(input, size)); }, minNanoseconds);
+            results.push_back({ "getClosestToZero", kernelSet.name, size, bytes, closestRepetitions, closestNs, bandwidth });
+            auto [chunksNs, chunksRepetitions] = measure([&] { keep(kernelSet.countChunks(input, size)); }, minNanoseconds);
+            results.push_back({ "countChunks", kernelSet.name, size, bytes, chunksRepetitions, chunksNs, bandwidth });
+            auto [statisticsNs, statisticsRepetitions] = measure([&] { keep(kernelSet.scanStatistics(input, size)); }, minNanoseconds);
+            results.push_back({ "scanStatistics", kernelSet.name, size, bytes, statisticsRepetitions, statisticsNs, bandwidth });
+            auto [nearestNs, nearestRepetitions] = measure([&] { keep(kernelSet.getNearest(input, size, 0, 10)); }, minNanoseconds);
+            results.push_back({ "getNearest", kernelSet.name, size, bytes, nearestRepetitions, nearestNs, bandwidth });
+
+            measureElements<int8_t>(kernelSet, "int8", input, bytes, bandwidth, minNanoseconds, results);
+            measureElements<int16_t>(kernelSet, "int16", input, bytes, bandwidth, minNanoseconds, results);
+            measureElements<int64_t>(kernelSet, "int64", input, bytes, bandwidth, minNanoseconds, results);
+            measureElements<float>(kernelSet, "float", input, bytes, bandwidth, minNanoseconds, results);
+        }
+    }
+
+    // the traversals are bound by the latency of the pointer chasing, the bytes are the nodes and the pointers to them
+    for (size_t power = 10; power + 4 <= parsedArgs.maxPower; power += 2)
+    {
+        size_t nodeCount = size_t{1} << power;
+        auto [root, levelCount] = buildTree(nodeCount, random);
+        size_t bytes = nodeCount * (sizeof(BenchNode) + sizeof(unique_ptr<INode>));
+        size_t deepest = levelCount - 1; // the whole tree is traversed
+
+        const pair<const char *, int (*)(const INode&, size_t)> levelSumKernels[] = {
+            { "scalar", getLevelSumScalar }, { "tasks", getLevelSumTasks }, { "frontier", getLevelSumFrontier }, { "parallel", getLevelSumParallel }
+        };
+        for (auto [name, kernel] : levelSumKernels)
+        {
+            auto [ns, repetitions] = measure([&] { keep(kernel(*root, deepest)); }, minNanoseconds);
+            results.push_back({ "getLevelSum", name, nodeCount, bytes, repetitions, ns, 0 });
+        }
+        const pair<const char *, vector<int64_t> (*)(const INode&)> levelSumsKernels[] = {
+            { "scalar", getLevelSumsScalar }, { "frontier", getLevelSumsFrontier }
+        };
+        for (auto [name, kernel] : levelSumsKernels)
+        {
+            auto [ns, repetitions] = measure([&] { keep(kernel(*root)); }, minNanoseconds);
+            results.push_back({ "getLevelSums", name, nodeCount, bytes, repetitions, ns, 0 });
+        }
+    }
+
+    // the planners are far from the memory bandwidth, smaller arrays suffice
+    for (size_t power = 10; power + 6 <= parsedArgs.maxPower && power <= 18; power += 2)
+    {
+        size_t size = size_t{1} << power;
+        span<const int> input(data.get(), size);
+        const pair<const char *, ReversalPlan> plans[] = { { "insertion", ReversalPlan::INSERTION }, { "selection", ReversalPlan::SELECTION } };
+        for (auto [name, plan] : plans)
+        {
+            auto [ns, repetitions] = measure([&] { keep(getReversalsToSort(input, plan)); }, minNanoseconds);
+            results.push_back({ "getReversalsToSort", name, size, size * sizeof(int), repetitions, ns, 0 });
+        }
+    }
+
+    ofstream outputFile;
+    if (!parsedArgs.outputPath.empty())
+    {
+        outputFile.open(parsedArgs.outputPath);
+        if (!outputFile.is_open())
+        {
+            cerr << "Error: Could not open output file '" << parsedArgs.outputPath << "'." << endl;
+            exit(-1);
+        }
+    }
+    ostream& output = parsedArgs.outputPath.empty() ? cout : outputFile;
+    if (parsedArgs.format == "json")
+    {
+        writeJSON(output, results);
+    }
+    else
+    {
+        writeCSV(output, results);
+    }
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <new>
+
+using namespace std;
+
+thread_local NodeArena *NodeArena::_current = nullptr;
+
+NodeArena::Scope::Scope(NodeArena& arena) : _previous{_current}
+{
+    _current = &arena;
+}
+
+NodeArena::Scope::~Scope()
+{
+    _current = _previous;
+}
+
+void* NodeArena::allocate(size_t bytes)
+{
+    bytes = (sizeof(Header) + bytes + sizeof(Header) - 1) / sizeof(Header) * sizeof(Header); // the next allocation stays aligned as well
+    Header *header = static_cast<Header *>(_current != nullptr ? _current->allocateInBlock(bytes) : ::operator new(bytes));
+    header->arena = _current;
+    header->bytes = bytes;
+    return header + 1;
+}
+
+void NodeArena::deallocate(void* p) noexcept
+{
+    if (p == nullptr)
+    {
+        return;
+    }
+    Header *header = static_cast<Header *>(p) - 1;
+    if (header->arena == nullptr)
+    {
+        ::operator delete(header);
+        return;
+    }
+    try
+    {
+        header->arena->freeList(header->bytes).push_back(reinterpret_cast<byte *>(header));
+    }
+    catch (const bad_alloc&)
+    {
+        // the allocation is not reused, but it is still freed with the arena
+    }
+}
+
+size_t NodeArena::allocatedBytes() const
+{
+    return _allocatedBytes;
+}
+
+byte* NodeArena::allocateInBlock(size_t bytes)
+{
+    vector<byte *>& reusable = freeList(bytes);
+    if (!reusable.empty())
+    {
+        byte *allocation = reusable.back();
+        reusable.pop_back();
+        return allocation;
+    }
+
+    if (static_cast<size_t>(_end - _next) < bytes)
+    {
+        // the rest of the last block is wasted, larger objects get a block of their own
+        constexpr size_t ALIGNMENT = AlignedAllocator<byte>::alignment;
+        size_t blockSize = max(BLOCK_SIZE, (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+        _blocks.emplace_back(AlignedAllocator<byte>{}.allocate(blockSize));
+        _allocatedBytes += blockSize;
+        _next = _blocks.back().get();
+        _end = _next + blockSize;
+    }
+
+    byte *allocation = _next;
+    _next += bytes;
+    return allocation;
+}
+
+vector<byte *>& NodeArena::freeList(size_t bytes)
+{
+    for (auto &[size, list] : _freeLists)
+    {
+        if (size == bytes)
+        {
+            return list;
+        }
+    }
+    return _freeLists.emplace_back(bytes, vector<byte *>{}).second;
+}
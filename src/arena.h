@@ -0,0 +1,101 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "AlignedAllocator.hpp"
+
+/**
+ * Bump allocator of many small objects, which are released all at once, e.g. nodes of a trie.
+ *
+ * The memory is allocated in large cache-line aligned blocks and objects are placed one after another,
+ * so an allocation is just a pointer increment and destroying the arena frees whole blocks without
+ * visiting the objects. The arena is not thread-safe, each thread should allocate from its own arena.
+ * Only the blocks are aligned to the cache lines, each object follows its header, see below, so the objects are
+ * aligned only to 'alignof(std::max_align_t)' and a small object may straddle two cache lines.
+ *
+ * Objects are allocated with the static 'allocate' function from the arena of the active 'Scope' of the calling thread,
+ * or from the heap, when there is no active scope. Each allocation remembers its origin and size in a small header,
+ * so 'deallocate' works for both. Deallocated memory of an arena is kept in a free list of its size and reused
+ * by the next allocation of the same size, e.g. nodes of erased words are reused by inserted words.
+ * Deallocation is not thread-safe either, it must not run concurrently with other operations of the same arena.
+ */
+class NodeArena
+{
+public:
+    constexpr static std::size_t BLOCK_SIZE = 1 << 20;
+
+    NodeArena() = default;
+    ~NodeArena() = default;
+
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+    NodeArena(NodeArena&&) = delete; // the allocations point to their arena
+    NodeArena& operator=(NodeArena&&) = delete;
+
+    /**
+     * Makes the arena the source of the allocations of the current thread until the scope ends.
+     */
+    class Scope
+    {
+    public:
+        Scope(NodeArena& arena);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        NodeArena *_previous;
+    };
+
+    /**
+     * Stateless allocator of the standard containers using 'allocate' and 'deallocate', e.g. for the children of a node.
+     * Containers with this allocator have the same layout as with 'std::allocator'.
+     */
+    template<typename T>
+    struct Allocator
+    {
+        using value_type = T;
+
+        Allocator() = default;
+        template<typename U>
+        constexpr Allocator(const Allocator<U>&) noexcept {}
+
+        [[nodiscard]] T* allocate(std::size_t n) { return static_cast<T *>(NodeArena::allocate(n * sizeof(T))); }
+        void deallocate(T* p, std::size_t) noexcept { NodeArena::deallocate(p); }
+
+        template<typename U>
+        constexpr bool operator==(const Allocator<U>&) const noexcept { return true; }
+    };
+
+    /**
+     * Allocates 'bytes' aligned to 'alignof(std::max_align_t)' from the arena of the active scope, or from the heap.
+     */
+    static void* allocate(std::size_t bytes);
+    static void deallocate(void* p) noexcept;
+
+    std::size_t allocatedBytes() const; // size of all the blocks
+
+private:
+    struct alignas(std::max_align_t) Header // keeps the objects aligned to 'max_align_t', but not to the cache lines
+    {
+        NodeArena *arena;  // nullptr for the heap
+        std::size_t bytes; // size of the allocation including the header
+    };
+
+    std::vector<std::unique_ptr<std::byte[], AlignedAllocator<std::byte>::Deleter>> _blocks;
+    std::size_t _allocatedBytes = 0;
+    std::byte *_next = nullptr; // free space of the last block
+    std::byte *_end = nullptr;
+    std::vector<std::pair<std::size_t, std::vector<std::byte *>>> _freeLists; // free allocations by their size, there are only a few sizes
+
+    static thread_local NodeArena *_current;
+
+    std::byte* allocateInBlock(std::size_t bytes);
+    std::vector<std::byte *>& freeList(std::size_t bytes);
+};
+
+#endif // _ARENA_H_
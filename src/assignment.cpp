@@ -1,14 +1,18 @@
 #include "INode.h"
 #include "assignment.h"
+#include "dispatch.h"
+#include "kernels.h"
+#include "treap.h"
 
 #if !defined(_APPROACH_1_) && !defined(_APPROACH_2_) && !defined(_APPROACH_3_)
-    #define _APPROACH_1_ // default approach
+    #define _APPROACH_DISPATCH_ // default approach - kernels are selected at runtime based on the CPU features, see 'dispatch.cpp'
 #endif
 
 #if 0 // change to 1 to activate all approaches - just for better readability in IDEs like VSC
     #define _APPROACH_1_
     #define _APPROACH_2_
     #define _APPROACH_3_
+    #define _APPROACH_DISPATCH_
 #endif
 
 using namespace std; // let's avoid typing 'std::' everywhere
@@ -25,7 +29,7 @@ using namespace std; // let's avoid typing 'std::' everywhere
  * If there are two equally close to zero elements like 2 and -2,
  * then consider the positive element to be "closer" to zero.
  */
-int getClosestToZero(const vector<int>& arr) 
+int getClosestToZero(span<const int> arr) 
 {
     if (arr.empty())
     {
@@ -34,7 +38,7 @@ int getClosestToZero(const vector<int>& arr)
 
 #ifdef _APPROACH_1_
     // Naive approach: Sort the array (sorting does not have to be stable) and try to return non-negative element from the values with the smallest distance to zero
-    vector<int> sortedArr(arr); // make a copy to avoid side effects, that makes the space complexity O(n)
+    vector<int> sortedArr(arr.begin(), arr.end()); // make a copy to avoid side effects, that makes the space complexity O(n)
     auto compareLambda = [](int a, int b) { return abs(a) < abs(b); };
     sort(sortedArr.begin(), sortedArr.end(), compareLambda); // O(n*log(n))
     int smallestDistance = sortedArr[0];
@@ -58,56 +62,25 @@ int getClosestToZero(const vector<int>& arr)
 #endif
 
 #ifdef _APPROACH_3_
-    using int32_16_t = __m512i;
-
-    // OpenMP + AVX approach: Use OpenMP for parallelism and AVX for vectorization
-    int smallestDistance = INT32_MAX;
-    #pragma omp parallel // start threads
-    {
-        // distribute the data among threads
-        size_t elementsPerThread = arr.size() / omp_get_num_threads();
-        size_t threadOffset = elementsPerThread * omp_get_thread_num();
-        const int *data = arr.data() + threadOffset;
-
-        // assume data are aligned to 64 bytes - must be, otherwise the program will crash
-        const int32_16_t *dataVector = reinterpret_cast<const int32_16_t *>(data);
-        int32_16_t threadSmallestDistances = _mm512_set1_epi32(INT32_MAX); 
-        constexpr int SIMD_LEN = 16;
-        
-        for (size_t i = 0; i < elementsPerThread / SIMD_LEN; i++)
-        {
-            int32_16_t batch = _mm512_load_si512(dataVector + i);
-
-            // calculate the absolute values of elements in a vector
-            int32_16_t absBatch = _mm512_abs_epi32(batch);
-            int32_16_t absSmallestBatch = _mm512_abs_epi32(threadSmallestDistances);
-            
-            // perform the 2-key comparison as in the 2nd approach but on a vector
-            uint16_t smallerBitmap = _mm512_cmp_epi32_mask(absBatch, absSmallestBatch, _MM_CMPINT_LT);
-            uint16_t equalBitmap = _mm512_cmp_epi32_mask(absBatch, absSmallestBatch, _MM_CMPINT_EQ);
-            uint16_t largerBitmap = _mm512_cmp_epi32_mask(batch, threadSmallestDistances, _MM_CMPINT_GT);
-            uint16_t finalBitmap = smallerBitmap | (equalBitmap & largerBitmap);
-
-            // update the smallest distances based on the comparison results
-            threadSmallestDistances = _mm512_mask_mov_epi32(threadSmallestDistances, finalBitmap, batch);
-        }
-
-        const int *lanes = reinterpret_cast<const int *>(&threadSmallestDistances);
-        // reduce the vector of 16 elements to a single element
-        int threadSmallestDistance = *min_element(lanes, lanes + SIMD_LEN, [](int a, int b) { return abs(a) < abs(b) || (abs(a) == abs(b) && a > b); }); 
+    // OpenMP + AVX approach: Use OpenMP for parallelism and AVX for vectorization, see 'getClosestToZeroAVX512' in 'kernels.cpp'.
+    // Each thread performs the same 2-key comparison as in the 2nd approach on vectors of 16 elements, the per-thread results are reduced at the end.
+    // The first and last vectors of each thread are loaded with masks, so the data can have any length and alignment.
+    return getClosestToZeroAVX512(arr.data(), arr.size());
+    // Time complexity: O(n/p), where p is the number of threads
+    // Space complexity: O(p)
+#endif
 
-        #pragma omp critical // reduce the results among threads, avoid race condition
-        {
-            smallestDistance = abs(threadSmallestDistance) < abs(smallestDistance) || 
-                              (abs(threadSmallestDistance) == abs(smallestDistance) && threadSmallestDistance > smallestDistance) ? 
-                                    threadSmallestDistance : 
-                                    smallestDistance;
-        }
-    }
-    return smallestDistance;
+#ifdef _APPROACH_DISPATCH_
+    // Production approach: the fastest kernel supported by the CPU (AVX-512BW, AVX2, SSE4.1 or scalar), can be pinned with '--kernel'
+    return activeKernelSet().getClosestToZero(arr.data(), arr.size());
 #endif
 }
 
+int getClosestToZero(const vector<int>& arr)
+{
+    return getClosestToZero(span<const int>(arr));
+}
+
 /**
  * Please implement this method to return count of chunks in given array.
  *
@@ -116,7 +89,7 @@ int getClosestToZero(const vector<int>& arr)
  *
  * Example: [5, 4, 0, 0, -1, 0, 2, 0, 0] contains 3 chunks
  */
-size_t countChunks(const vector<int>& arr)
+size_t countChunks(span<const int> arr)
 {
     if (arr.empty())
     {
@@ -149,43 +122,98 @@ size_t countChunks(const vector<int>& arr)
 #endif
 
 #ifdef _APPROACH_3_
-    // Single core approach, but with AVX vectorization
-    // Parallelism could be added as well similarly to the 3rd approach in the 'getClosestToZero' function
-    using int32_16_t = __m512i;
-    
-    // assume the data is aligned to 64 bytes - must be, otherwise the program will crash
-    const int32_16_t *data = reinterpret_cast<const int32_16_t *>(arr.data());
-    size_t chunkCount = 0;
-    bool inChunk = false;
-    constexpr int SIMD_LEN = 16;
-    
-    for (size_t i = 0; i < arr.size() / SIMD_LEN; i++)
-    {
-        int32_16_t batch = _mm512_load_si512(data + i);
-        uint16_t cmpBitmap = _mm512_cmp_epi32_mask(batch, _mm512_setzero_si512(), _MM_CMPINT_EQ); // compare 16 elements with zero using single instruction
+    // OpenMP + AVX approach: each thread counts chunks in its part of the array, see 'countChunksAVX512' in 'kernels.cpp'.
+    // A vector of 16 elements is compared with zero using single instruction, chunk starts are then counted from the resulting bitmap
+    // with 'popcount'. Chunks crossing the boundary of two parts are counted in both parts, which is fixed by checking the first and last
+    // elements of the neighbouring parts.
+    return countChunksAVX512(arr.data(), arr.size());
+    // Time complexity: O(n/p), where p is the number of threads, the kernel is eventually bound by the memory bandwidth
+#endif
 
-        // assume zeros are quite rare, then the branch prediction should be quite good and the following code won't be executed often
-        if (cmpBitmap) // at least one zero in the batch
-        {
-            int *batchData = reinterpret_cast<int *>(&batch);
-            for (size_t j = 0; j < SIMD_LEN; j++) // perform the same operation as in the 1st approach, but only on the batch of 16 elements
-            {
-                bool notZero = batchData[j] != 0;
-                chunkCount += !inChunk && notZero;
-                inChunk = notZero;
-            }
-        }
-        else if (!inChunk) // no zero in the batch and not currently not in any chunk
-        {
-            chunkCount++;
-            inChunk = true;
-        }
-    }
-    return chunkCount;
-    // Time complexity: remains O(n), but the algorithm is potentially faster due to vectorization
+#ifdef _APPROACH_DISPATCH_
+    // Production approach: the fastest kernel supported by the CPU, the vector kernels count chunk starts from bitmaps of non-zero elements
+    return activeKernelSet().countChunks(arr.data(), arr.size());
 #endif
 }
 
+size_t countChunks(const vector<int>& arr)
+{
+    return countChunks(span<const int>(arr));
+}
+
+/**
+ * Both functions for the other element types, the approaches above are written for 'int', so all of them use the kernels
+ * selected at runtime, the AVX-512BW kernels process 64, 32, 8 or 16 elements per instruction instead of 16 widened ones.
+ */
+template <typename T>
+static T getClosestToZeroElements(span<const T> arr)
+{
+    if (arr.empty())
+    {
+        throw invalid_argument("Empty vector, 'getClosestToZero' expects at least one element in the input vector");
+    }
+    return activeKernelSet().elementKernels<T>().getClosestToZero(arr.data(), arr.size());
+}
+
+template <typename T>
+static size_t countChunksElements(span<const T> arr)
+{
+    return arr.empty() ? 0 : activeKernelSet().elementKernels<T>().countChunks(arr.data(), arr.size());
+}
+
+int8_t getClosestToZero(span<const int8_t> arr)
+{
+    return getClosestToZeroElements(arr);
+}
+
+int16_t getClosestToZero(span<const int16_t> arr)
+{
+    return getClosestToZeroElements(arr);
+}
+
+int64_t getClosestToZero(span<const int64_t> arr)
+{
+    return getClosestToZeroElements(arr);
+}
+
+float getClosestToZero(span<const float> arr)
+{
+    return getClosestToZeroElements(arr);
+}
+
+size_t countChunks(span<const int8_t> arr)
+{
+    return countChunksElements(arr);
+}
+
+size_t countChunks(span<const int16_t> arr)
+{
+    return countChunksElements(arr);
+}
+
+size_t countChunks(span<const int64_t> arr)
+{
+    return countChunksElements(arr);
+}
+
+size_t countChunks(span<const float> arr)
+{
+    return countChunksElements(arr);
+}
+
+/**
+ * Generalization of 'getClosestToZero' to the 'k' nearest elements to any target. There is only the production approach,
+ * the naive one would be the same as the 1st approach of 'getClosestToZero', i.e. sorting the whole array by the distance,
+ * the kernels keep only the 'k' nearest elements seen so far instead, see 'getNearestAVX512' in 'kernels.cpp'.
+ */
+vector<int> getNearest(span<const int> arr, int target, size_t k)
+{
+    return activeKernelSet().getNearest(arr.data(), arr.size(), target, k);
+    // Time complexity: O(n/p + (p*k + c)*log(k)), where p is the number of threads and c the number of candidates replacing
+    //                  the farthest element of a heap, which is small unless the data are ordered by a decreasing distance
+    // Space complexity: O(p*k)
+}
+
 /**
  * Open INode.h to see the INode interface.
  *
@@ -250,57 +278,61 @@ int getLevelSum(const INode& root, size_t n)
 
 #ifdef _APPROACH_3_
     // OpenMP approach, depth-first traversal similar to the 1st approach but with task parallelism.
-    function<int(const INode&, size_t)> taskLambda = [&taskLambda](const INode& root, size_t n) -> int
+    // A task per node costs more than summing the node, so tasks are spawned only for the subtrees of the first levels
+    // and each task sums into a per-thread partial sum instead of an atomic update of a shared sum. When the first levels
+    // have too few subtrees to balance the threads, the tree is traversed level by level with each level split among the threads.
+    return getLevelSumParallel(root, n);
+#endif
+
+#ifdef _APPROACH_DISPATCH_
+    // Production approach: parallel traversal selected by the width of the first levels, sequential depth-first with the scalar kernels
+    return activeKernelSet().getLevelSum(root, n);
+#endif
+}
+
+/**
+ * Returns the sums of the node values at every level of the tree computed in a single traversal, i.e. the element 'n'
+ * is the same as 'getLevelSum(root, n)', but with a 64-bit accumulator. Levels below the deepest node are not included.
+ * Reports of many levels are therefore linear in the number of nodes instead of being multiplied by the number of levels.
+ */
+vector<int64_t> getLevelSums(const INode& root)
+{
+    // the nodes of each level are split among the threads, a single thread traverses the tree depth-first without collecting the levels
+    return omp_get_max_threads() > 1 ? getLevelSumsFrontier(root) : getLevelSumsScalar(root);
+}
+
+/**
+ * Removes the reversals, which have no effect on the order, i.e. the reversals of a single element
+ * and the pairs of the same reversals following each other, which cancel out.
+ */
+static void cancelReversals(vector<size_t>& reversals)
+{
+    // Removing a pair can make its neighbours a new pair, e.g. [3, 2, 2, 3], i.e. the pairs nest like parentheses.
+    // The kept reversals are therefore a stack at the front of the vector, a reversal equal to the top of the stack
+    // cancels out with it, so all the nested pairs are removed in a single pass instead of rescanning until no pair is left.
+    size_t top = 0; // size of the stack
+    for (size_t reversal : reversals)
     {
-        if (n == 0) // required level reached - base case
+        if (reversal <= 1) // a single element (or nothing) is always in order
+        {
+            continue;
+        }
+        if (top > 0 && reversals[top - 1] == reversal)
         {
-            return root.value();
+            top--;
         }
         else
         {
-            int sum = 0;
-            for (const auto &child : root.children())
-            {
-                if (child != nullptr)
-                {
-                    INode *childPtr = child.get();
-                    #pragma omp task shared(sum) firstprivate(childPtr) // parallelize the work - spawn a task
-                    #pragma omp atomic update  // avoid race condition
-                    sum += taskLambda(*childPtr, n - 1); // recursion
-                }
-            }
-
-            #pragma omp taskwait // wait for all spawned tasks to finish before returning the result
-                                 // actually, the tasks are dispatched to the waiting threads at this point
-            return sum;
+            reversals[top++] = reversal;
         }
-    };
-
-    int sum = 0;
-    #pragma omp parallel
-    {
-        #pragma omp master // spawn the tasks by a single thread
-        sum = taskLambda(root, n);
     }
-    return sum;
-#endif
+    reversals.resize(top);
 }
 
 /**
- * Imagine a sort algorithm, that sorts array of integers by repeatedly reversing
- * the order of the first several elements of it.
- *
- * For example, to sort [12,13,11,14], you need to reverse the order of the first two (2)
- * elements. You will get [13,12,11,14].
- * Then you shall reverse the order of the first three (3) elements,
- * and you will get [11,12,13,14]
- *
- * For this assignment you shall implement function
- * that returns list of integers corresponding to the required reversals.
- * E.g. for given vector [12,13,11,14]
- * the function should return [2, 3].
+ * Sorts by inserting the elements one by one into the sorted prefix, up to 4 reversals per element.
  */
-vector<size_t> getReversalsToSort(const vector<int>& arr)
+static vector<size_t> getInsertionReversals(span<const int> arr)
 {
     // Let's use some kind of divide and conquer approach.
     // We can interpret sorting as repeatedly placing an element to its correct position in a sorted array, i.e. insertion sort.
@@ -324,80 +356,175 @@ vector<size_t> getReversalsToSort(const vector<int>& arr)
     */
     // Without any proof, this algorithm should work for any input array.   
 
-    // standard binary search in a sorted array returning an index, where the searched element is located or should be inserted at
-    auto binaryIdxSearch = [](const vector<int>& sorted, int element) -> size_t
+    // The position of the new element in the sorted prefix is the number of the already sorted elements lower than it.
+    // Instead of inserting into a sorted vector, which moves half of it on average, the sorted elements are counted
+    // in a Fenwick tree indexed by the rank of the value among all the (distinct) values of the array.
+    vector<int> values(arr.begin(), arr.end());
+    sort(values.begin(), values.end());
+    values.erase(unique(values.begin(), values.end()), values.end());
+
+    vector<size_t> counts(values.size() + 1, 0); // Fenwick tree, the element 'r' counts the ranks (r - (r & -r), r]
+    auto countLower = [&counts](size_t rank) -> size_t // number of the inserted elements with a lower rank
     {
-        size_t left = 0;
-        size_t right = sorted.size();
-        while (left < right)
+        size_t count = 0;
+        for (; rank > 0; rank &= rank - 1) // drop the lowest set bit
         {
-            size_t middle = (left + right) >> 1; // halve the search interval
-            if (sorted[middle] < element)
-            {
-                left = middle + 1;
-            }
-            else
-            {
-                right = middle;
-            }
+            count += counts[rank];
         }
-        return left;
+        return count;
+    };
+    auto insertRank = [&counts](size_t rank)
+    {
+        for (rank++; rank < counts.size(); rank += rank & (~rank + 1)) // add the lowest set bit
+        {
+            counts[rank]++;
+        }
+    };
+    auto rankOf = [&values](int element) -> size_t
+    {
+        return lower_bound(values.begin(), values.end(), element) - values.begin();
     };
 
     vector<size_t> reversals;
-    vector<int> sorted;
-    sorted.push_back(arr[0]);
+    reversals.reserve(4 * (arr.size() - 1));
+    insertRank(rankOf(arr[0]));
     for (size_t i = 1; i < arr.size(); i++)
     {
         // the simplest solution
         // of course, there are many ways how to generate less reversals
         reversals.push_back(i);
         reversals.push_back(i + 1);
-        //size_t correctIdx = binaryIdxSearch(sorted, arr[i]);
-        size_t correctIdx = lower_bound(sorted.begin(), sorted.end(), arr[i]) - sorted.begin();
+        size_t rank = rankOf(arr[i]);
+        size_t correctIdx = countLower(rank); // the same as 'lower_bound' in the sorted prefix
         reversals.push_back(correctIdx + 1);
         reversals.push_back(correctIdx); // assume that 0 elements can be reversed for simplicity
-        sorted.insert(sorted.begin() + correctIdx, arr[i]); 
+        insertRank(rank);
     }
-    // Time complexity (of this algorithm): O(n*log(n)) if 'insert' is in O(log(n)) or faster, otherwise O(n^2), i.e. this case with STL vector
-    // Space complexity: O(n) - both 'reversals' and 'sorted' grow linearly with the input array
+    // Time complexity (of this algorithm): O(n*log(n)) - sorting the values, and a binary search and 2 Fenwick tree operations per element
+    // Space complexity: O(n) - 'reversals', 'values' and 'counts' grow linearly with the input array
 
-    // The following code is just post-processing of the reversals vector to make it more efficient.
-    for (size_t &reversal : reversals)
+    // The reversals of a single element and the pairs of the same consecutive reversals are removed afterwards.
+    cancelReversals(reversals);
+    return reversals;
+}
+
+/**
+ * Sorts by moving the maximum of the unsorted prefix to its end, i.e. the classic pancake sort, up to 2 reversals per element.
+ */
+template<typename EMIT>
+static void planSelectionReversals(span<const int> arr, EMIT emit)
+{
+    // The unsorted prefix is kept in a treap, so the reversals are simulated in O(log n) instead of moving the elements.
+    /*
+        3 1 4 2   4 1 3 2   2 3 1 4   3 2 1 4   1 2 3 4
+                  (3)       (4)       (2)       (3)
+    */
+    // Each step places the maximum of the prefix at the front and then reverses the whole prefix to move it to the end.
+    // The reversals are skipped, when the maximum is already at the front or at the end, and the sorting ends as soon
+    // as the prefix is sorted, which the treap knows without visiting the elements, a reversed prefix takes one more reversal.
+    // The reversals are passed to 'emit' as soon as they are known, e.g. they are encoded right away without collecting them.
+    ReversalTreap prefix(arr);
+    while (!prefix.ascending())
     {
-        if (reversal == 1) // mark reversals of a single element as useless
+        size_t size = prefix.size();
+        if (prefix.descending())
         {
-            reversal = 0;
+            emit(size);
+            break;
         }
-    }
 
-    // remove redundant reversals, i.e. 2 same consecutive reversals
-    bool modified = true;
-    while (modified) // each removal can create a new redundant reversals
-    {
-        modified = false;
-        size_t lastValue = 0;
-        size_t lastIdx = 0;
-        for (size_t i = 0; i < reversals.size(); i++)
+        size_t position = prefix.popMaximum(); // the maximum is at its final position
+        if (position + 1 < size)
         {
-            if (reversals[i] != 0) // skip the already removed reversals
+            if (position > 0)
             {
-                if (reversals[i] == lastValue) // two consecutive same reversals
-                {
-                    // mark the pair of reversals as useless
-                    reversals[lastIdx] = 0;
-                    reversals[i] = 0;
-
-                    modified = true;
-                }
-                lastValue = reversals[i];
-                lastIdx = i;
+                emit(position + 1);
             }
+            emit(size);
         }
     }
+    // Time complexity: O(n*log(n)) expected - a split and a merge of the treap per element
+    // Space complexity: O(n) - the treap, the reversals are not stored
+}
 
-    // pack the vector (move all non-zeros to the front with 'remove' and truncate the vector with 'erase')
-    reversals.erase(remove(reversals.begin(), reversals.end(), 0), reversals.end());
-    
+static vector<size_t> getSelectionReversals(span<const int> arr)
+{
+    vector<size_t> reversals;
+    planSelectionReversals(arr, [&reversals](size_t reversal) { reversals.push_back(reversal); });
     return reversals;
 }
+
+/**
+ * Imagine a sort algorithm, that sorts array of integers by repeatedly reversing
+ * the order of the first several elements of it.
+ *
+ * For example, to sort [12,13,11,14], you need to reverse the order of the first two (2)
+ * elements. You will get [13,12,11,14].
+ * Then you shall reverse the order of the first three (3) elements,
+ * and you will get [11,12,13,14]
+ *
+ * For this assignment you shall implement function
+ * that returns list of integers corresponding to the required reversals.
+ * E.g. for given vector [12,13,11,14]
+ * the function should return [2, 3].
+ *
+ * The 'plan' selects the algorithm, the insertion plan produces up to 4 reversals per element,
+ * the selection plan at most 2. Both run in O(n*log(n)), but the treap of the selection plan is several times slower.
+ */
+vector<size_t> getReversalsToSort(span<const int> arr, ReversalPlan plan)
+{
+    if (arr.empty())
+    {
+        return {};
+    }
+    return plan == ReversalPlan::SELECTION ? getSelectionReversals(arr) : getInsertionReversals(arr);
+}
+
+vector<size_t> getReversalsToSort(const vector<int>& arr, ReversalPlan plan)
+{
+    return getReversalsToSort(span<const int>(arr), plan);
+}
+
+/**
+ * The same plan as 'getReversalsToSort', but written to 'writer' as it is produced. The selection plan is never stored,
+ * the insertion plan is collected first, because a reversal can be cancelled out by any later reversal.
+ */
+void writeReversalsToSort(span<const int> arr, ReversalPlan plan, PlanWriter& writer)
+{
+    if (plan == ReversalPlan::SELECTION && !arr.empty())
+    {
+        planSelectionReversals(arr, [&writer](size_t reversal) { writer.write(reversal); });
+        return;
+    }
+    for (size_t reversal : getReversalsToSort(arr, plan))
+    {
+        writer.write(reversal);
+    }
+}
+
+/**
+ * Verifies a plan of 'getReversalsToSort' on any array, e.g. a plan computed elsewhere.
+ * Replaying a reversal on the array moves up to all of its elements, i.e. O(n^2) for a whole plan, while the treap reverses
+ * a prefix in O(log n) without moving the elements and knows whether the whole sequence is sorted without visiting them.
+ */
+bool isSortedByReversals(span<const int> arr, span<const size_t> reversals)
+{
+    ReversalTreap sequence(arr);
+    for (size_t reversal : reversals)
+    {
+        sequence.reverse(reversal);
+    }
+    return sequence.ascending();
+}
+
+bool isSortedByReversals(span<const int> arr, PlanReader& reader)
+{
+    // the plan is decoded while it is being applied, i.e. it is never stored
+    ReversalTreap sequence(arr);
+    size_t reversal;
+    while (reader.next(reversal))
+    {
+        sequence.reverse(reversal);
+    }
+    return sequence.ascending();
+}
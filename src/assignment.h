@@ -9,13 +9,41 @@
 #include <immintrin.h> // AVX instructions
 #include <queue>       // queue
 #include <omp.h>       // OpenMP functions
+#include <span>        // span
 
 #include "INode.h"
+#include "plan.h"
 
 int getClosestToZero(const std::vector<int>& arr);
+int getClosestToZero(std::span<const int> arr); // any buffer, e.g. a memory-mapped file or a sub-range, without copying it into a vector
 
 std::size_t countChunks(const std::vector<int>& arr);
+std::size_t countChunks(std::span<const int> arr);
+
+// other element types, e.g. 16-bit sensor data, processed without widening to 'int', see 'kernels.h' for the float semantics
+std::int8_t getClosestToZero(std::span<const std::int8_t> arr);
+std::int16_t getClosestToZero(std::span<const std::int16_t> arr);
+std::int64_t getClosestToZero(std::span<const std::int64_t> arr);
+float getClosestToZero(std::span<const float> arr);
+std::size_t countChunks(std::span<const std::int8_t> arr);
+std::size_t countChunks(std::span<const std::int16_t> arr);
+std::size_t countChunks(std::span<const std::int64_t> arr);
+std::size_t countChunks(std::span<const float> arr);
+
+// the 'k' elements nearest to 'target' ordered from the nearest one, equally distant elements are ordered from the larger one,
+// i.e. the same tie-break as of 'getClosestToZero', fewer elements are returned only when the array is shorter
+std::vector<int> getNearest(std::span<const int> arr, int target, std::size_t k);
 
 int getLevelSum(const INode& root, std::size_t n);
+// sums of the node values of all the levels computed in a single traversal, indexed by the level, levels below the tree are not included
+std::vector<std::int64_t> getLevelSums(const INode& root);
+
+// algorithm of 'getReversalsToSort', the insertion plan is faster, the selection plan needs about half of the reversals
+enum class ReversalPlan { INSERTION, SELECTION };
 
-std::vector<std::size_t> getReversalsToSort(const std::vector<int>& arr);
\ No newline at end of file
+std::vector<std::size_t> getReversalsToSort(const std::vector<int>& arr, ReversalPlan plan = ReversalPlan::INSERTION);
+std::vector<std::size_t> getReversalsToSort(std::span<const int> arr, ReversalPlan plan = ReversalPlan::INSERTION);
+void writeReversalsToSort(std::span<const int> arr, ReversalPlan plan, PlanWriter& writer); // encodes the plan as it is produced
+// applies the reversals to the array and returns whether it is sorted, throws 'out_of_range' when a reversal is longer than the array
+bool isSortedByReversals(std::span<const int> arr, std::span<const std::size_t> reversals);
+bool isSortedByReversals(std::span<const int> arr, PlanReader& reader); // also throws 'runtime_error' of the reader
\ No newline at end of file
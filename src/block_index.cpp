@@ -0,0 +1,173 @@
+#include "block_index.h"
+#include "dispatch.h"
+
+#include <algorithm>   // min
+#include <cstdint>
+#include <cstdio>      // rename
+#include <cstring>     // memcmp
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+#include <sys/stat.h>  // stat
+
+using namespace std;
+
+static_assert(is_trivially_copyable_v<ScanStatistics>, "The summaries are written to the index as they are in memory");
+
+// the fields are compared one by one, the padding of the stored summaries is arbitrary
+static bool sameStatistics(const ScanStatistics& left, const ScanStatistics& right)
+{
+    return left.closest == right.closest && left.minimum == right.minimum && left.maximum == right.maximum
+           && left.chunkCount == right.chunkCount && left.zeroCount == right.zeroCount && left.longestChunk == right.longestChunk
+           && left.size == right.size && left.leadingChunk == right.leadingChunk && left.trailingChunk == right.trailingChunk;
+}
+
+BlockIndex::BlockIndex(span<const int> data, size_t blockInts) : _data{data}, _blockInts{blockInts}
+{
+    if (blockInts == 0)
+    {
+        throw invalid_argument("Block index needs a non-zero block size");
+    }
+    _blocks.resize((data.size() + blockInts - 1) / blockInts);
+
+    // a block per iteration, the kernels called inside of the parallel loop run on a single thread, nested regions are inactive
+    const KernelSet& kernels = activeKernelSet();
+    #pragma omp parallel for schedule(static)
+    for (size_t block = 0; block < _blocks.size(); block++)
+    {
+        size_t begin = block * blockInts;
+        _blocks[block] = kernels.scanStatistics(data.data() + begin, min(blockInts, data.size() - begin));
+    }
+}
+
+BlockIndex::BlockIndex(span<const int> data, const string& indexPath, const FileVersion& version) : _data{data}
+{
+    ifstream file(indexPath, ios::binary);
+    if (!file.is_open())
+    {
+        throw runtime_error("Could not open index file '" + indexPath + "'");
+    }
+
+    char magic[sizeof(BLOCK_INDEX_MAGIC)];
+    uint64_t header[6]; // block size, number of integers, size of a summary, file size, modification seconds and nanoseconds
+    if (!file.read(magic, sizeof(magic)) || memcmp(magic, BLOCK_INDEX_MAGIC, sizeof(magic)) != 0
+        || !file.read(reinterpret_cast<char *>(header), sizeof(header)) || header[0] == 0 || header[2] != sizeof(ScanStatistics))
+    {
+        throw runtime_error("File '" + indexPath + "' is not a block index");
+    }
+    if (header[1] != data.size() || header[3] != version.bytes || header[4] != version.seconds || header[5] != version.nanoseconds)
+    {
+        throw runtime_error("Index file '" + indexPath + "' is out of date");
+    }
+
+    _blockInts = header[0];
+    _blocks.resize((data.size() + _blockInts - 1) / _blockInts);
+    if (!file.read(reinterpret_cast<char *>(_blocks.data()), _blocks.size() * sizeof(ScanStatistics)))
+    {
+        throw runtime_error("Index file '" + indexPath + "' is truncated");
+    }
+
+    // only the two end blocks are rescanned, so opening the index costs O(blockInts) like a query
+    const KernelSet& kernels = activeKernelSet();
+    for (size_t block : { size_t{0}, _blocks.size() - 1 })
+    {
+        if (block >= _blocks.size()) // no block of an empty file
+        {
+            break;
+        }
+        size_t begin = block * _blockInts;
+        if (!sameStatistics(_blocks[block], kernels.scanStatistics(data.data() + begin, min(_blockInts, data.size() - begin))))
+        {
+            throw runtime_error("Index file '" + indexPath + "' is out of date");
+        }
+    }
+}
+
+BlockIndex BlockIndex::open(span<const int> data, const string& dataPath)
+{
+    // the version is taken before the index is built, so a file modified meanwhile makes the stored index out of date
+    string path = indexPath(dataPath);
+    FileVersion version = fileVersion(dataPath);
+    try
+    {
+        return BlockIndex(data, path, version);
+    }
+    catch (const runtime_error& e)
+    {
+        // missing or out of date, built again below
+    }
+    BlockIndex index(data);
+    index.save(path, version);
+    return index;
+}
+
+string BlockIndex::indexPath(const string& dataPath)
+{
+    return dataPath + ".idx";
+}
+
+BlockIndex::FileVersion BlockIndex::fileVersion(const string& dataPath)
+{
+    struct stat fileStat;
+    if (stat(dataPath.c_str(), &fileStat) != 0)
+    {
+        throw runtime_error("Could not access file '" + dataPath + "'");
+    }
+    return { static_cast<uint64_t>(fileStat.st_size), static_cast<uint64_t>(fileStat.st_mtim.tv_sec),
+             static_cast<uint64_t>(fileStat.st_mtim.tv_nsec) };
+}
+
+void BlockIndex::save(const string& indexPath, const FileVersion& version) const
+{
+    // written to a temporary file first, so a concurrent reader never sees a partially written index
+    string temporaryPath = indexPath + ".tmp";
+    {
+        ofstream file(temporaryPath, ios::binary | ios::trunc);
+        uint64_t header[6] = { _blockInts, _data.size(), sizeof(ScanStatistics), version.bytes, version.seconds, version.nanoseconds };
+        file.write(BLOCK_INDEX_MAGIC, sizeof(BLOCK_INDEX_MAGIC));
+        file.write(reinterpret_cast<const char *>(header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(_blocks.data()), _blocks.size() * sizeof(ScanStatistics));
+        file.close();
+        if (!file)
+        {
+            remove(temporaryPath.c_str());
+            throw runtime_error("Could not write index file '" + indexPath + "'");
+        }
+    }
+    if (rename(temporaryPath.c_str(), indexPath.c_str()) != 0)
+    {
+        remove(temporaryPath.c_str());
+        throw runtime_error("Could not write index file '" + indexPath + "'");
+    }
+}
+
+ScanStatistics BlockIndex::query(size_t begin, size_t end) const
+{
+    if (begin > end || end > _data.size())
+    {
+        throw out_of_range("Range [" + to_string(begin) + ", " + to_string(end) + ") is not inside of the "
+                           + to_string(_data.size()) + " integers");
+    }
+
+    const KernelSet& kernels = activeKernelSet();
+    size_t firstBlock = (begin + _blockInts - 1) / _blockInts; // the first block starting inside of the range
+    size_t lastBlock = end / _blockInts;                       // the block containing the end of the range
+    if (firstBlock >= lastBlock) // no whole block, the range is shorter than two blocks
+    {
+        return kernels.scanStatistics(_data.data() + begin, end - begin);
+    }
+
+    // the merge stitches the chunks across the block boundaries, the same as between the parts of the threads
+    ScanStatistics statistics = kernels.scanStatistics(_data.data() + begin, firstBlock * _blockInts - begin);
+    for (size_t block = firstBlock; block < lastBlock; block++)
+    {
+        statistics = mergeStatistics(statistics, _blocks[block]);
+    }
+    return mergeStatistics(statistics, kernels.scanStatistics(_data.data() + lastBlock * _blockInts, end - lastBlock * _blockInts));
+}
+
+size_t BlockIndex::blockInts() const
+{
+    return _blockInts;
+}
@@ -0,0 +1,86 @@
+#ifndef _BLOCK_INDEX_H_
+#define _BLOCK_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "kernels.h"
+
+constexpr char BLOCK_INDEX_MAGIC[8] = { 'B', 'L', 'K', 'I', 'D', 'X', '2', '\n' };
+
+/**
+ * Index of a binary file of integers for queries of its sub-ranges, e.g. 'countChunks' of the integers '[begin, end)'.
+ *
+ * The array is split into blocks of 'blockInts' integers and the index keeps the 'ScanStatistics' of each block,
+ * i.e. its chunk count, whether its first and last elements are non-zero, its element closest to zero and the rest of
+ * the statistics of test 5. A query merges the statistics of the whole blocks inside of the range and scans only
+ * the parts of the blocks at its ends, so it costs O((end - begin) / blockInts + blockInts) instead of O(end - begin).
+ *
+ * The index is stored next to the data file, see 'indexPath', as the 8-byte 'BLOCK_INDEX_MAGIC', the block size,
+ * the number of the integers, the size of a summary, the size of the data file and the seconds and nanoseconds of its
+ * modification time as 8-byte integers followed by the summaries of the blocks, all in the native endianness.
+ * The index is out of date, when the size or the modification time of the file changed or the summary of its first
+ * or last block does not match the data any more, the blocks are rescanned for the latter, because a rewrite within
+ * the resolution of the file system timestamps or a copy keeping them does not change the modification time.
+ */
+class BlockIndex
+{
+public:
+    static constexpr std::size_t DEFAULT_BLOCK_INTS = 1 << 16; // 256 KiB blocks fit into the L2 cache
+
+    /**
+     * Size and modification time of a data file, stored in its index.
+     */
+    struct FileVersion
+    {
+        std::uint64_t bytes = 0;
+        std::uint64_t seconds = 0;
+        std::uint64_t nanoseconds = 0;
+    };
+
+    /**
+     * Builds the index of the data, the blocks are summarized in parallel.
+     */
+    BlockIndex(std::span<const int> data, std::size_t blockInts = DEFAULT_BLOCK_INTS);
+
+    /**
+     * Reads the index of the data from the file, throws 'runtime_error' when the file cannot be read,
+     * is not an index or is an index of a different version of the data file.
+     */
+    BlockIndex(std::span<const int> data, const std::string& indexPath, const FileVersion& version);
+
+    /**
+     * Returns the index stored next to the data file, the index is built and stored first, when it is missing or out of date.
+     * Throws 'runtime_error' when the built index cannot be stored.
+     */
+    static BlockIndex open(std::span<const int> data, const std::string& dataPath);
+
+    static std::string indexPath(const std::string& dataPath); // the data path followed by '.idx'
+
+    /**
+     * Returns the size and modification time of the data file, throws 'runtime_error' when the file cannot be accessed.
+     */
+    static FileVersion fileVersion(const std::string& dataPath);
+
+    /**
+     * Writes the index of the given version of the data file to the file, throws 'runtime_error' when writing fails.
+     */
+    void save(const std::string& indexPath, const FileVersion& version) const;
+
+    /**
+     * Returns the statistics of the integers '[begin, end)', throws 'out_of_range' when the range is not inside of the data.
+     */
+    ScanStatistics query(std::size_t begin, std::size_t end) const;
+
+    std::size_t blockInts() const;
+
+private:
+    std::span<const int> _data;
+    std::size_t _blockInts;
+    std::vector<ScanStatistics> _blocks; // the last block may be shorter
+};
+
+#endif // _BLOCK_INDEX_H_
@@ -0,0 +1,204 @@
+#include "compact_trie.h"
+
+#include <algorithm>
+#include <bit>       // popcount
+#include <execution> // execution::par
+#include <fstream>
+#include <iostream>
+#include <numeric>   // accumulate
+#include <stdexcept>
+#include <unistd.h>  // STDOUT_FILENO
+
+using namespace std;
+
+CompactTrie::CompactTrie(const string& fileName)
+{
+    ifstream file(fileName);
+    if (!file.is_open())
+    {
+        throw runtime_error("Could not open file '" + fileName + "'.");
+    }
+
+    vector<string> words;
+    string line;
+    while (getline(file, line))
+    {
+        if (!line.empty())
+        {
+            words.push_back(move(line));
+        }
+    }
+    build(words);
+}
+
+CompactTrie::CompactTrie(vector<string> words)
+{
+    erase(words, string()); // empty words are ignored the same way as empty lines
+    build(words);
+}
+
+void CompactTrie::build(vector<string>& words)
+{
+    // Sorted words sharing a prefix form a contiguous range, so each node corresponds to a range of words
+    // and its children to the sub-ranges with the same character at the node's depth.
+    // The string comparison compares unsigned characters, i.e. the order of the children in the mask.
+    sort(execution::par, words.begin(), words.end()); // the only part of the build, which does not scale linearly
+    words.erase(unique(words.begin(), words.end()), words.end());
+
+    vector<pair<size_t, size_t>> ranges{ { 0, words.size() } }; // range of words of each node, the nodes are processed in order
+    _nodes.emplace_back();
+    _values.push_back(0);
+    _levelStart.push_back(0);
+
+    for (size_t level = 0; _levelStart.back() < _nodes.size(); level++)
+    {
+        size_t levelEnd = _nodes.size(); // the children of this level are appended behind, i.e. they form the next level
+        for (size_t index = _levelStart.back(); index < levelEnd; index++)
+        {
+            auto [begin, end] = ranges[index];
+            if (begin < end && words[begin].size() == level) // the word ending here is the shortest, so it is the first one
+            {
+                _nodes[index].endOfWord = true;
+                begin++;
+            }
+
+            if (_nodes.size() > UINT32_MAX)
+            {
+                throw length_error("Too many nodes of a compact trie");
+            }
+            _nodes[index].firstChild = static_cast<uint32_t>(_nodes.size());
+            while (begin < end)
+            {
+                unsigned char c = static_cast<unsigned char>(words[begin][level]);
+                size_t childEnd = begin + 1;
+                while (childEnd < end && static_cast<unsigned char>(words[childEnd][level]) == c)
+                {
+                    childEnd++;
+                }
+
+                _nodes[index].childMask[c >> 6] |= uint64_t{1} << (c & 63);
+                _nodes[index].childCount++;
+                _nodes.emplace_back(); // may reallocate, so the current node is always accessed by its index
+                _values.push_back(static_cast<int>(static_cast<char>(c))); // the same value as of 'Trie', i.e. a signed character
+                ranges.push_back({ begin, childEnd });
+                begin = childEnd;
+            }
+        }
+        _levelStart.push_back(levelEnd); // the end of the last level is the number of nodes
+    }
+    _nodes.shrink_to_fit();
+    _values.shrink_to_fit();
+}
+
+int64_t CompactTrie::levelSum(size_t n) const
+{
+    if (n + 1 >= _levelStart.size())
+    {
+        return 0; // below the deepest node
+    }
+    // the values of a level are contiguous, the compiler vectorizes the widening sum
+    return accumulate(_values.begin() + _levelStart[n], _values.begin() + _levelStart[n + 1], int64_t{0});
+}
+
+vector<int64_t> CompactTrie::levelSums() const
+{
+    vector<int64_t> sums(levelCount());
+    for (size_t level = 0; level < sums.size(); level++)
+    {
+        sums[level] = levelSum(level);
+    }
+    return sums;
+}
+
+bool CompactTrie::contains(const string& word) const
+{
+    size_t index = 0;
+    for (char c : word)
+    {
+        index = childIndex(_nodes[index], static_cast<unsigned char>(c));
+        if (index == 0)
+        {
+            return false;
+        }
+    }
+    return !word.empty() && _nodes[index].endOfWord;
+}
+
+size_t CompactTrie::nodeCount() const
+{
+    return _nodes.size();
+}
+
+size_t CompactTrie::levelCount() const
+{
+    return _levelStart.size() - 1;
+}
+
+size_t CompactTrie::memoryBytes() const
+{
+    return _nodes.capacity() * sizeof(Node) + _values.capacity() * sizeof(int) + _levelStart.capacity() * sizeof(size_t);
+}
+
+void CompactTrie::print() const
+{
+    cout.flush(); // the words are written directly to the file descriptor, after anything printed before
+    WordWriter writer(STDOUT_FILENO);
+    exportWords(writer);
+    writer.finish();
+}
+
+void CompactTrie::printASCII() const
+{
+    cout.flush();
+    WordWriter writer(STDOUT_FILENO, WordWriter::Format::ASCII);
+    exportWords(writer);
+    writer.finish();
+}
+
+size_t CompactTrie::childIndex(const Node& node, unsigned char c) const
+{
+    uint64_t bit = uint64_t{1} << (c & 63);
+    if ((node.childMask[c >> 6] & bit) == 0)
+    {
+        return 0;
+    }
+
+    // the rank of the character among the children, i.e. the number of children with a lower character
+    size_t rank = popcount(node.childMask[c >> 6] & (bit - 1));
+    for (size_t i = 0; i < static_cast<size_t>(c >> 6); i++)
+    {
+        rank += popcount(node.childMask[i]);
+    }
+    return node.firstChild + rank;
+}
+
+void CompactTrie::exportWords(WordWriter& writer) const
+{
+    // iterative depth-first traversal in the order of the characters, the children of a node are next to each other
+    vector<pair<size_t, size_t>> stack{ { 0, 0 } }; // node and its level
+    string currentWord;
+    while (!stack.empty())
+    {
+        auto [index, level] = stack.back();
+        stack.pop_back();
+        if (level > 0)
+        {
+            currentWord.resize(level - 1);
+            currentWord.push_back(static_cast<char>(_values[index]));
+        }
+
+        const Node& node = _nodes[index];
+        if (node.endOfWord)
+        {
+            writer.writeWord(currentWord);
+        }
+        for (size_t child = node.firstChild + node.childCount; child > node.firstChild; child--) // the lowest character on the top
+        {
+            // the levels are far apart in the breadth-first layout, so the grandchildren are prefetched long before they are visited,
+            // the pointer arithmetic instead of indexing, because 'firstChild' of the last leaves is one past the end of the vectors
+            __builtin_prefetch(_nodes.data() + _nodes[child - 1].firstChild);
+            __builtin_prefetch(_values.data() + _nodes[child - 1].firstChild);
+            stack.push_back({ child - 1, level + 1 });
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#include "dispatch.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+namespace
+{
+    const KernelSet *detectKernelSet()
+    {
+        for (const KernelSet &kernelSet : kernelSets())
+        {
+            if (kernelSet.isSupported())
+            {
+                return &kernelSet;
+            }
+        }
+        return &kernelSets().back(); // unreachable, the scalar kernels are always supported
+    }
+
+    const KernelSet *activeKernels = detectKernelSet(); // detect the CPU features at startup
+
+    // only AVX-512BW has vector kernels of the other element types, the other vector sets split the scalar kernel among the threads
+    template <typename T>
+    ElementKernels<T> avx512Kernels()
+    {
+        return { getClosestToZeroAVX512<T>, countChunksAVX512<T> };
+    }
+
+    template <typename T>
+    ElementKernels<T> threadKernels()
+    {
+        return { getClosestToZeroThreads<T>, countChunksThreads<T> };
+    }
+
+    template <typename T>
+    ElementKernels<T> scalarKernels()
+    {
+        return { getClosestToZeroScalar<T>, countChunksScalar<T> };
+    }
+}
+
+const vector<KernelSet>& kernelSets()
+{
+    // '__builtin_cpu_supports' checks also the OS support of the extended registers
+    static const vector<KernelSet> sets = {
+        { "avx512bw", [] { return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("popcnt"); },
+          getClosestToZeroAVX512, countChunksAVX512, scanStatisticsAVX512, getNearestAVX512, getLevelSumParallel,
+          avx512Kernels<int8_t>(), avx512Kernels<int16_t>(), avx512Kernels<int64_t>(), avx512Kernels<float>() },
+        { "avx2", [] { return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"); },
+          getClosestToZeroAVX2, countChunksAVX2, scanStatisticsAVX2, getNearestAVX2, getLevelSumParallel,
+          threadKernels<int8_t>(), threadKernels<int16_t>(), threadKernels<int64_t>(), threadKernels<float>() },
+        { "sse4.1", [] { return __builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("popcnt"); },
+          getClosestToZeroSSE41, countChunksSSE41, scanStatisticsSSE41, getNearestSSE41, getLevelSumParallel,
+          threadKernels<int8_t>(), threadKernels<int16_t>(), threadKernels<int64_t>(), threadKernels<float>() },
+        { "scalar", [] { return true; },
+          getClosestToZeroScalar, countChunksScalar, scanStatisticsScalar, getNearestScalar, getLevelSumScalar,
+          scalarKernels<int8_t>(), scalarKernels<int16_t>(), scalarKernels<int64_t>(), scalarKernels<float>() },
+    };
+    return sets;
+}
+
+const KernelSet& activeKernelSet()
+{
+    return *activeKernels;
+}
+
+void selectKernelSet(const string& name)
+{
+    if (name == "auto")
+    {
+        activeKernels = detectKernelSet();
+        return;
+    }
+
+    for (const KernelSet &kernelSet : kernelSets())
+    {
+        if (kernelSet.name == name)
+        {
+            if (!kernelSet.isSupported())
+            {
+                throw invalid_argument("Kernel '" + name + "' is not supported by this CPU");
+            }
+            activeKernels = &kernelSet;
+            return;
+        }
+    }
+    throw invalid_argument("Unknown kernel '" + name + "'");
+}
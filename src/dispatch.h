@@ -0,0 +1,80 @@
+#ifndef _DISPATCH_H_
+#define _DISPATCH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "INode.h"
+#include "kernels.h"
+
+/**
+ * Kernels of the 'getClosestToZero' and 'countChunks' functions for arrays of another element type than 'int'.
+ */
+template <typename T>
+struct ElementKernels
+{
+    T (*getClosestToZero)(const T *data, std::size_t size);
+    std::size_t (*countChunks)(const T *data, std::size_t size);
+};
+
+/**
+ * Kernels of the assignment functions compiled for a single instruction set.
+ */
+struct KernelSet
+{
+    std::string name;      // name used with the '--kernel' switch
+    bool (*isSupported)(); // returns true when the current CPU (and OS) can execute the kernels
+    int (*getClosestToZero)(const int *data, std::size_t size);
+    std::size_t (*countChunks)(const int *data, std::size_t size);
+    ScanStatistics (*scanStatistics)(const int *data, std::size_t size);
+    std::vector<int> (*getNearest)(const int *data, std::size_t size, int target, std::size_t k);
+    int (*getLevelSum)(const INode& root, std::size_t n);
+    ElementKernels<std::int8_t> int8;
+    ElementKernels<std::int16_t> int16;
+    ElementKernels<std::int64_t> int64;
+    ElementKernels<float> float32;
+
+    template <typename T>
+    const ElementKernels<T>& elementKernels() const
+    {
+        if constexpr (std::is_same_v<T, std::int8_t>)
+        {
+            return int8;
+        }
+        else if constexpr (std::is_same_v<T, std::int16_t>)
+        {
+            return int16;
+        }
+        else if constexpr (std::is_same_v<T, std::int64_t>)
+        {
+            return int64;
+        }
+        else
+        {
+            static_assert(std::is_same_v<T, float>, "Unsupported element type");
+            return float32;
+        }
+    }
+};
+
+/**
+ * Returns all kernel sets ordered from the fastest to the slowest, the last one is supported on any CPU.
+ */
+const std::vector<KernelSet>& kernelSets();
+
+/**
+ * Returns the kernels used by the assignment functions. These are the fastest kernels supported by the CPU,
+ * unless a specific kernel set was pinned with 'selectKernelSet'.
+ */
+const KernelSet& activeKernelSet();
+
+/**
+ * Pins the kernel set with the given name, "auto" restores the selection based on the CPU features.
+ * Throws 'invalid_argument' for unknown names and kernels, which the CPU does not support.
+ */
+void selectKernelSet(const std::string& name);
+
+#endif // _DISPATCH_H_
@@ -0,0 +1,206 @@
+#include "export.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>     // memcpy, strerror
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>  // mmap, munmap
+#include <unistd.h>    // write, ftruncate, sysconf
+
+using namespace std;
+
+namespace
+{
+    /**
+     * Returns the codes of all the characters formatted the same as with 'setw(4)', the codes are between -128 and 127,
+     * so they always fit into 4 columns. The table is indexed by the unsigned character.
+     */
+    constexpr array<array<char, 4>, 256> asciiCodes()
+    {
+        array<array<char, 4>, 256> codes{};
+        for (int i = 0; i < 256; i++)
+        {
+            int code = static_cast<int>(static_cast<signed char>(i));
+            int magnitude = code < 0 ? -code : code;
+            codes[i] = { ' ', ' ', ' ', ' ' };
+            int column = 3;
+            do
+            {
+                codes[i][column--] = static_cast<char>('0' + magnitude % 10);
+                magnitude /= 10;
+            } while (magnitude > 0);
+            if (code < 0)
+            {
+                codes[i][column] = '-';
+            }
+        }
+        return codes;
+    }
+
+    constexpr array<array<char, 4>, 256> ASCII_CODES = asciiCodes();
+}
+
+WordWriter::WordWriter(int fileDescriptor, Format format, Output output, size_t bufferBytes)
+    : _fileDescriptor{fileDescriptor}, _format{format}, _output{output}, _bufferBytes{max(bufferBytes, size_t{4096})}
+{
+    if (_output == Output::WRITE)
+    {
+        _storage.reset(new char[_bufferBytes]);
+        _buffer = _position = _storage.get();
+        _end = _buffer + _bufferBytes;
+    }
+    else
+    {
+        mapWindow(0);
+    }
+}
+
+WordWriter::~WordWriter()
+{
+    try
+    {
+        finish();
+    }
+    catch (const exception& e)
+    {
+        // destructors must not throw, call 'finish' explicitly to handle the errors
+    }
+}
+
+void WordWriter::setFormat(Format format)
+{
+    _format = format;
+}
+
+void WordWriter::writeWord(string_view word)
+{
+    if (_format == Format::TEXT)
+    {
+        char *line = reserve(word.size() + 1);
+        memcpy(line, word.data(), word.size());
+        line[word.size()] = '\n';
+        _position = line + word.size() + 1;
+        return;
+    }
+
+    // each character is replaced by its 4 columns wide code from the table, there is no formatting of the numbers
+    char *line = reserve(4 * word.size() + 1);
+    for (char c : word)
+    {
+        memcpy(line, ASCII_CODES[static_cast<unsigned char>(c)].data(), 4);
+        line += 4;
+    }
+    *line++ = '\n';
+    _position = line;
+}
+
+void WordWriter::writeText(string_view text)
+{
+    char *destination = reserve(text.size());
+    memcpy(destination, text.data(), text.size());
+    _position = destination + text.size();
+}
+
+void WordWriter::finish()
+{
+    if (_finished)
+    {
+        return;
+    }
+    _finished = true;
+
+    if (_output == Output::WRITE)
+    {
+        flush();
+    }
+    else
+    {
+        size_t written = _bufferOffset + static_cast<size_t>(_position - _buffer);
+        munmap(_buffer, static_cast<size_t>(_end - _buffer));
+        _buffer = _position = _end = nullptr;
+        if (ftruncate(_fileDescriptor, static_cast<off_t>(written)) != 0) // cut off the unused rest of the last window
+        {
+            throw runtime_error(string("Could not truncate the output file: ") + strerror(errno));
+        }
+    }
+}
+
+char* WordWriter::reserve(size_t bytes)
+{
+    if (_finished)
+    {
+        throw logic_error("Writing to a finished word writer");
+    }
+    if (static_cast<size_t>(_end - _position) >= bytes)
+    {
+        return _position;
+    }
+
+    if (_output == Output::WRITE)
+    {
+        flush();
+        if (bytes > _bufferBytes) // a single line longer than the buffer
+        {
+            _bufferBytes = bytes;
+            _storage.reset(new char[_bufferBytes]);
+            _buffer = _position = _storage.get();
+            _end = _buffer + _bufferBytes;
+        }
+    }
+    else
+    {
+        mapWindow(bytes);
+    }
+    return _position;
+}
+
+void WordWriter::flush()
+{
+    const char *data = _buffer;
+    while (data < _position)
+    {
+        ssize_t written = write(_fileDescriptor, data, static_cast<size_t>(_position - data));
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            throw runtime_error(string("Could not write the output: ") + strerror(errno));
+        }
+        data += written;
+    }
+    _position = _buffer;
+}
+
+void WordWriter::mapWindow(size_t bytes)
+{
+    // the next window starts at the page containing the current position, the file is extended to cover the whole window
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t written = _bufferOffset + static_cast<size_t>(_position - _buffer);
+    size_t windowOffset = written / pageSize * pageSize;
+    size_t windowBytes = max(_bufferBytes, bytes + written - windowOffset);
+    windowBytes = (windowBytes + pageSize - 1) / pageSize * pageSize;
+
+    if (_buffer != nullptr)
+    {
+        munmap(_buffer, static_cast<size_t>(_end - _buffer));
+        _buffer = _position = _end = nullptr;
+    }
+    if (ftruncate(_fileDescriptor, static_cast<off_t>(windowOffset + windowBytes)) != 0)
+    {
+        throw runtime_error(string("Could not extend the output file: ") + strerror(errno));
+    }
+    void *window = mmap(nullptr, windowBytes, PROT_READ | PROT_WRITE, MAP_SHARED, _fileDescriptor, static_cast<off_t>(windowOffset));
+    if (window == MAP_FAILED)
+    {
+        throw runtime_error(string("Could not map the output file: ") + strerror(errno));
+    }
+
+    _buffer = static_cast<char *>(window);
+    _bufferOffset = windowOffset;
+    _position = _buffer + (written - windowOffset);
+    _end = _buffer + windowBytes;
+}
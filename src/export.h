@@ -0,0 +1,56 @@
+#ifndef _EXPORT_H_
+#define _EXPORT_H_
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+/**
+ * Buffered writer of the words of a dictionary, one word per line, either as text or as codes of the characters.
+ *
+ * With 'Output::WRITE' the lines are formatted into a large reusable buffer, which is written to the file descriptor
+ * only when it is full, i.e. there is a system call per megabytes instead of per word. With 'Output::MMAP' the lines
+ * are formatted directly into a memory-mapped window of the output file, which must be a regular file opened for
+ * reading and writing, the window slides forward as the file grows. The written data are complete after 'finish'.
+ */
+class WordWriter
+{
+public:
+    enum class Format { TEXT, ASCII }; // ASCII writes each character as its (signed) code right-aligned to 4 columns
+    enum class Output { WRITE, MMAP };
+
+    WordWriter(int fileDescriptor, Format format = Format::TEXT, Output output = Output::WRITE, std::size_t bufferBytes = 4 << 20);
+    ~WordWriter(); // calls 'finish', errors are ignored
+
+    WordWriter(const WordWriter&) = delete;
+    WordWriter& operator=(const WordWriter&) = delete;
+
+    void setFormat(Format format);
+    void writeWord(std::string_view word); // writes the word in the current format followed by a new line
+    void writeText(std::string_view text); // writes the text as it is
+
+    /**
+     * Writes out the buffered data, or unmaps the window and truncates the file to the written size with 'Output::MMAP'.
+     * Throws 'runtime_error' when writing fails.
+     */
+    void finish();
+
+private:
+    int _fileDescriptor;
+    Format _format;
+    Output _output;
+    std::size_t _bufferBytes;
+
+    std::unique_ptr<char[]> _storage; // the buffer of 'Output::WRITE', not zero-initialized
+    char *_buffer = nullptr;      // the buffer or the mapped window
+    char *_position = nullptr;    // end of the written data in the buffer
+    char *_end = nullptr;
+    std::size_t _bufferOffset = 0; // offset of the buffer in the output file, used only with 'Output::MMAP'
+    bool _finished = false;
+
+    char* reserve(std::size_t bytes); // returns space for at least 'bytes' bytes at '_position'
+    void flush();
+    void mapWindow(std::size_t bytes);
+};
+
+#endif // _EXPORT_H_
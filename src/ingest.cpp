@@ -0,0 +1,88 @@
+#include "ingest.h"
+#include "dispatch.h"
+
+#include <cstdint>
+#include <cstdio>      // rename, remove
+#include <cstring>     // memcmp
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+using namespace std;
+
+static_assert(is_trivially_copyable_v<ScanStatistics>, "The statistics are written to the state as they are in memory");
+
+IngestState::IngestState(const string& dataPath, span<const int> data) : _statePath{statePath(dataPath)}
+{
+    ifstream file(_statePath, ios::binary);
+    char magic[sizeof(INGEST_STATE_MAGIC)];
+    uint64_t header[3]; // number of the processed integers, the last processed integer, size of the statistics
+    ScanStatistics statistics;
+    if (!file.read(magic, sizeof(magic)) || memcmp(magic, INGEST_STATE_MAGIC, sizeof(magic)) != 0
+        || !file.read(reinterpret_cast<char *>(header), sizeof(header)) || header[2] != sizeof(ScanStatistics)
+        || !file.read(reinterpret_cast<char *>(&statistics), sizeof(statistics)))
+    {
+        return; // missing or not a state, everything is processed
+    }
+
+    int last = static_cast<int>(static_cast<int64_t>(header[1]));
+    if (header[0] > data.size() || statistics.size != header[0] || (header[0] > 0 && data[header[0] - 1] != last))
+    {
+        return; // truncated or rewritten, processed again from the beginning
+    }
+    _processed = header[0];
+    _last = last;
+    _statistics = statistics;
+}
+
+string IngestState::statePath(const string& dataPath)
+{
+    return dataPath + ".state";
+}
+
+size_t IngestState::update(span<const int> data)
+{
+    span<const int> appended = data.subspan(_processed);
+    if (!appended.empty())
+    {
+        // the merge continues the last chunk of the state, when both the last processed and the first appended integers are non-zero
+        _statistics = mergeStatistics(_statistics, activeKernelSet().scanStatistics(appended.data(), appended.size()));
+        _processed = data.size();
+        _last = data.back();
+    }
+    return appended.size();
+}
+
+void IngestState::save() const
+{
+    // written to a temporary file first, so an interrupted run leaves the previous state
+    string temporaryPath = _statePath + ".tmp";
+    {
+        ofstream file(temporaryPath, ios::binary | ios::trunc);
+        uint64_t header[3] = { _processed, static_cast<uint64_t>(static_cast<int64_t>(_last)), sizeof(ScanStatistics) };
+        file.write(INGEST_STATE_MAGIC, sizeof(INGEST_STATE_MAGIC));
+        file.write(reinterpret_cast<const char *>(header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(&_statistics), sizeof(_statistics));
+        file.close();
+        if (!file)
+        {
+            remove(temporaryPath.c_str());
+            throw runtime_error("Could not write state file '" + _statePath + "'");
+        }
+    }
+    if (rename(temporaryPath.c_str(), _statePath.c_str()) != 0)
+    {
+        remove(temporaryPath.c_str());
+        throw runtime_error("Could not write state file '" + _statePath + "'");
+    }
+}
+
+const ScanStatistics& IngestState::statistics() const
+{
+    return _statistics;
+}
+
+size_t IngestState::processed() const
+{
+    return _processed;
+}
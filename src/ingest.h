@@ -0,0 +1,55 @@
+#ifndef _INGEST_H_
+#define _INGEST_H_
+
+#include <cstddef>
+#include <span>
+#include <string>
+
+#include "kernels.h"
+
+constexpr char INGEST_STATE_MAGIC[8] = { 'I', 'N', 'G', 'E', 'S', 'T', '1', '\n' };
+
+/**
+ * Running statistics of a binary file of integers, which grows by appends, for the incremental mode of tests 1, 2 and 5.
+ *
+ * The state keeps the 'ScanStatistics' of the integers processed so far, i.e. among others the chunk count, whether
+ * the last element is non-zero and the element closest to zero. An update scans only the integers appended since then
+ * and merges their statistics into the state, so its cost is proportional to the appended data instead of the file size.
+ *
+ * The state is stored next to the data file, see 'statePath', as the 8-byte 'INGEST_STATE_MAGIC', the number of
+ * the processed integers, the last processed integer and the size of the statistics as 8-byte integers followed by
+ * the statistics, all in the native endianness. The state starts over, when the file is shorter than the processed
+ * integers or its last processed integer changed, i.e. the file was rewritten instead of appended to.
+ */
+class IngestState
+{
+public:
+    /**
+     * Reads the state of the data file, the state is empty, when it is missing, is not a state or is out of date.
+     */
+    IngestState(const std::string& dataPath, std::span<const int> data);
+
+    static std::string statePath(const std::string& dataPath); // the data path followed by '.state'
+
+    /**
+     * Processes the integers appended since the state was saved, i.e. '[processed(), data.size())'.
+     * Returns the number of the newly processed integers.
+     */
+    std::size_t update(std::span<const int> data);
+
+    /**
+     * Writes the state next to the data file, throws 'runtime_error' when writing fails.
+     */
+    void save() const;
+
+    const ScanStatistics& statistics() const;
+    std::size_t processed() const;
+
+private:
+    std::string _statePath;
+    std::size_t _processed = 0;
+    int _last = 0;              // the last processed integer, not valid when nothing was processed
+    ScanStatistics _statistics;
+};
+
+#endif // _INGEST_H_
@@ -0,0 +1,1234 @@
+#include "kernels.h"
+
+#include <algorithm>   // min, max
+#include <bit>         // popcount, countr_one, countl_one, bit_cast, rotl, rotr
+#include <climits>     // INT_MIN, INT_MAX
+#include <immintrin.h> // SSE/AVX instructions
+#include <omp.h>       // OpenMP functions
+
+// The kernels are compiled for specific instruction sets with function attributes instead of global compiler flags,
+// so the compiler cannot emit e.g. AVX-512 instructions anywhere else in the program and the binary runs on any x86-64 CPU.
+#define TARGET_SSE41 __attribute__((target("sse4.1,popcnt")))
+#define TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#define TARGET_AVX512 __attribute__((target("avx512f,avx512bw,popcnt")))
+
+using namespace std;
+
+namespace // helpers not visible outside of this translation unit
+{
+    /**
+     * Returns the number of elements before the first 64-byte aligned element of a range, at most 'size' and less than
+     * the number of elements in 64 bytes, e.g. 16 for 'int'.
+     */
+    template <typename T>
+    inline size_t headLength(const T *data, size_t size)
+    {
+        constexpr size_t VECTOR_LEN = 64 / sizeof(T);
+        size_t misalignedElements = (reinterpret_cast<uintptr_t>(data) & 63) / sizeof(T);
+        return min((VECTOR_LEN - misalignedElements) & (VECTOR_LEN - 1), size);
+    }
+
+    /**
+     * Returns a mask of the first 'length' lanes of a 16-lane vector, 'length' is at most 16.
+     */
+    inline uint16_t laneMask(size_t length)
+    {
+        return static_cast<uint16_t>((1u << length) - 1);
+    }
+
+    /**
+     * Returns a mask of the first 'length' lanes of a vector with up to 64 lanes, 'length' is at most the number of lanes.
+     */
+    template <typename MASK>
+    inline MASK lowLanes(size_t length)
+    {
+        return static_cast<MASK>(length >= 64 ? UINT64_MAX : (uint64_t{1} << length) - 1);
+    }
+
+    /**
+     * Sequential search for the closest element to zero in a range, which is not empty.
+     */
+    template <typename T>
+    T getClosestToZeroRange(const T *data, size_t size, T closest)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            closest = isCloserToZero(data[i], closest) ? data[i] : closest; // should compile to a conditional move
+        }
+        return closest;
+    }
+
+    // The same 2-key comparison as in 'isCloserToZero' performed on whole vectors, returns the lane-wise closer elements.
+    TARGET_SSE41 inline __m128i closerToZeroSSE41(__m128i batch, __m128i closest)
+    {
+        __m128i absBatch = _mm_abs_epi32(batch);
+        __m128i absClosest = _mm_abs_epi32(closest);
+
+        // there is no unsigned comparison in SSE, 'absBatch < absClosest' is therefore evaluated as 'max(absBatch, absClosest) != absBatch'
+        __m128i notSmaller = _mm_cmpeq_epi32(_mm_max_epu32(absBatch, absClosest), absBatch);
+        __m128i equal = _mm_cmpeq_epi32(absBatch, absClosest);
+        __m128i larger = _mm_cmpgt_epi32(batch, closest);
+        __m128i closer = _mm_or_si128(_mm_andnot_si128(notSmaller, _mm_set1_epi32(-1)), _mm_and_si128(equal, larger));
+
+        return _mm_blendv_epi8(closest, batch, closer);
+    }
+
+    TARGET_AVX2 inline __m256i closerToZeroAVX2(__m256i batch, __m256i closest)
+    {
+        __m256i absBatch = _mm256_abs_epi32(batch);
+        __m256i absClosest = _mm256_abs_epi32(closest);
+
+        __m256i notSmaller = _mm256_cmpeq_epi32(_mm256_max_epu32(absBatch, absClosest), absBatch);
+        __m256i equal = _mm256_cmpeq_epi32(absBatch, absClosest);
+        __m256i larger = _mm256_cmpgt_epi32(batch, closest);
+        __m256i closer = _mm256_or_si256(_mm256_andnot_si256(notSmaller, _mm256_set1_epi32(-1)), _mm256_and_si256(equal, larger));
+
+        return _mm256_blendv_epi8(closest, batch, closer);
+    }
+
+    TARGET_AVX512 inline __m512i closerToZeroAVX512(__m512i batch, __m512i closest)
+    {
+        // the masked variant of 'abs' avoids a false '-Wmaybe-uninitialized' warning from the GCC 12 headers
+        __m512i absBatch = _mm512_maskz_abs_epi32(0xFFFF, batch);
+        __m512i absClosest = _mm512_maskz_abs_epi32(0xFFFF, closest);
+
+        // AVX-512 has unsigned comparisons, the absolute value of INT32_MIN is then correctly the largest distance
+        __mmask16 smaller = _mm512_cmp_epu32_mask(absBatch, absClosest, _MM_CMPINT_LT);
+        __mmask16 equal = _mm512_cmp_epu32_mask(absBatch, absClosest, _MM_CMPINT_EQ);
+        __mmask16 larger = _mm512_cmp_epi32_mask(batch, closest, _MM_CMPINT_GT);
+
+        return _mm512_mask_mov_epi32(closest, smaller | (equal & larger), batch);
+    }
+
+    TARGET_SSE41 int getClosestToZeroSSE41Range(const int *data, size_t size)
+    {
+        constexpr size_t SIMD_LEN = 4;
+        __m128i closest = _mm_set1_epi32(data[0]);
+        size_t i = 0;
+        for (; i + SIMD_LEN <= size; i += SIMD_LEN)
+        {
+            closest = closerToZeroSSE41(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i)), closest);
+        }
+
+        // reduce the lanes and process the remaining elements, which do not fill a whole vector
+        alignas(16) int lanes[SIMD_LEN];
+        _mm_store_si128(reinterpret_cast<__m128i *>(lanes), closest);
+        return getClosestToZeroRange(data + i, size - i, getClosestToZeroRange(lanes, SIMD_LEN, lanes[0]));
+    }
+
+    TARGET_AVX2 int getClosestToZeroAVX2Range(const int *data, size_t size)
+    {
+        constexpr size_t SIMD_LEN = 8;
+        __m256i closest = _mm256_set1_epi32(data[0]);
+        size_t i = 0;
+        for (; i + SIMD_LEN <= size; i += SIMD_LEN)
+        {
+            closest = closerToZeroAVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i)), closest);
+        }
+
+        alignas(32) int lanes[SIMD_LEN];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), closest);
+        return getClosestToZeroRange(data + i, size - i, getClosestToZeroRange(lanes, SIMD_LEN, lanes[0]));
+    }
+
+    TARGET_AVX512 int getClosestToZeroAVX512Range(const int *data, size_t size)
+    {
+        constexpr size_t SIMD_LEN = 16;
+        __m512i closest = _mm512_set1_epi32(data[0]);
+
+        // the lanes outside of the range are loaded from the current 'closest' vector, so they cannot change it,
+        // the masked loads also do not fault on the masked out elements, so the range can end right before an unmapped page
+        size_t i = headLength(data, size);
+        closest = closerToZeroAVX512(_mm512_mask_loadu_epi32(closest, laneMask(i), data), closest);
+        for (; i + SIMD_LEN <= size; i += SIMD_LEN)
+        {
+            closest = closerToZeroAVX512(_mm512_loadu_si512(data + i), closest); // aligned after the head, unless the data are not aligned even to 'int'
+        }
+        closest = closerToZeroAVX512(_mm512_mask_loadu_epi32(closest, laneMask(size - i), data + i), closest);
+
+        alignas(64) int lanes[SIMD_LEN];
+        _mm512_store_si512(lanes, closest);
+        return getClosestToZeroRange(lanes, SIMD_LEN, lanes[0]);
+    }
+
+    /**
+     * Distributes the data among OpenMP threads, searches each part with the given kernel and reduces the results.
+     */
+    template <auto RANGE_KERNEL, typename T>
+    T getClosestToZeroParallel(const T *data, size_t size)
+    {
+        T closest = data[0];
+        #pragma omp parallel
+        {
+            auto [begin, end] = threadRange(size, omp_get_thread_num(), omp_get_num_threads());
+            if (begin < end) // there may be more threads than elements
+            {
+                T threadClosest = RANGE_KERNEL(data + begin, end - begin);
+
+                #pragma omp critical // reduce the results among threads, avoid race condition
+                closest = isCloserToZero(threadClosest, closest) ? threadClosest : closest;
+            }
+        }
+        return closest;
+    }
+
+    /**
+     * Counts chunks starting in a batch of elements given by a bitmap of its non-zero elements (the first element is the lowest bit).
+     * A chunk starts at each non-zero element, which is not preceded by another non-zero element.
+     * The bitmap type is given by 'previousNonZero', a 64-bit bitmap holds the batches of 64 bytes of 'int8_t'.
+     */
+    template <typename BITMAP>
+    inline size_t countChunkStarts(type_identity_t<BITMAP> nonZeroBitmap, BITMAP &previousNonZero, size_t batchLength)
+    {
+        if (batchLength == 0) // masked head or tail without any elements
+        {
+            return 0;
+        }
+        size_t starts = popcount(nonZeroBitmap & ~((nonZeroBitmap << 1) | previousNonZero));
+        previousNonZero = (nonZeroBitmap >> (batchLength - 1)) & 1;
+        return starts;
+    }
+
+    /**
+     * Counts chunks in the remaining elements of a range, 'previousNonZero' is the state after the already processed elements.
+     */
+    template <typename T>
+    inline size_t countChunksTail(const T *data, size_t size, uint32_t previousNonZero)
+    {
+        size_t chunkCount = 0;
+        bool inChunk = previousNonZero;
+        for (size_t i = 0; i < size; i++)
+        {
+            bool notZero = data[i] != 0;
+            chunkCount += !inChunk && notZero;
+            inChunk = notZero;
+        }
+        return chunkCount;
+    }
+
+    TARGET_SSE41 size_t countChunksSSE41Range(const int *data, size_t size)
+    {
+        constexpr size_t SIMD_LEN = 4;
+        size_t chunkCount = 0;
+        uint32_t previousNonZero = 0;
+        size_t i = 0;
+        for (; i + SIMD_LEN <= size; i += SIMD_LEN)
+        {
+            __m128i batch = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            uint32_t zeroBitmap = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(batch, _mm_setzero_si128()))); // one bit per 32-bit lane
+            chunkCount += countChunkStarts(~zeroBitmap & 0xF, previousNonZero, SIMD_LEN);
+        }
+        return chunkCount + countChunksTail(data + i, size - i, previousNonZero);
+    }
+
+    TARGET_AVX2 size_t countChunksAVX2Range(const int *data, size_t size)
+    {
+        constexpr size_t SIMD_LEN = 8;
+        size_t chunkCount = 0;
+        uint32_t previousNonZero = 0;
+        size_t i = 0;
+        for (; i + SIMD_LEN <= size; i += SIMD_LEN)
+        {
+            __m256i batch = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            uint32_t zeroBitmap = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(batch, _mm256_setzero_si256())));
+            chunkCount += countChunkStarts(~zeroBitmap & 0xFF, previousNonZero, SIMD_LEN);
+        }
+        return chunkCount + countChunksTail(data + i, size - i, previousNonZero);
+    }
+
+    TARGET_AVX512 size_t countChunksAVX512Range(const int *data, size_t size)
+    {
+        constexpr size_t SIMD_LEN = 16;
+        size_t chunkCount = 0;
+        uint32_t previousNonZero = 0;
+
+        // the masked out lanes are not included in the bitmap, the batch length must match the number of loaded elements
+        size_t i = headLength(data, size);
+        chunkCount += countChunkStarts(_mm512_test_epi32_mask(_mm512_maskz_loadu_epi32(laneMask(i), data), _mm512_set1_epi32(-1)), previousNonZero, i);
+        for (; i + SIMD_LEN <= size; i += SIMD_LEN)
+        {
+            __m512i batch = _mm512_loadu_si512(data + i);
+            uint32_t nonZeroBitmap = _mm512_test_epi32_mask(batch, batch); // compare 16 elements with zero using single instruction
+            chunkCount += countChunkStarts(nonZeroBitmap, previousNonZero, SIMD_LEN);
+        }
+        size_t tail = size - i;
+        chunkCount += countChunkStarts(_mm512_test_epi32_mask(_mm512_maskz_loadu_epi32(laneMask(tail), data + i), _mm512_set1_epi32(-1)), previousNonZero, tail);
+        return chunkCount;
+    }
+
+    /**
+     * Distributes the data among OpenMP threads and counts chunks in each part with the given kernel.
+     * Each part is counted as if it was preceded by a zero, so a chunk crossing the boundary of two parts is counted twice,
+     * i.e. once in each part, and must be subtracted.
+     */
+    template <auto RANGE_KERNEL, typename T>
+    size_t countChunksParallel(const T *data, size_t size)
+    {
+        size_t chunkCount = 0;
+        #pragma omp parallel reduction(+:chunkCount)
+        {
+            auto [begin, end] = threadRange(size, omp_get_thread_num(), omp_get_num_threads());
+            if (begin < end) // there may be more threads than elements
+            {
+                // the chunk continues from the previous part, when the elements on both sides of the boundary are non-zero,
+                // the first element of the part is then a counted chunk start, so the subtraction cannot underflow
+                bool stitched = begin > 0 && data[begin - 1] != 0 && data[begin] != 0;
+                chunkCount += RANGE_KERNEL(data + begin, end - begin) - stitched;
+            }
+        }
+        return chunkCount;
+    }
+
+    /**
+     * Returns the 'k' nearest of the values ordered from the nearest one.
+     */
+    vector<int> sortNearest(vector<int> values, int target, size_t k)
+    {
+        size_t count = min(k, values.size());
+        partial_sort(values.begin(), values.begin() + count, values.end(), [target](int a, int b) { return isNearer(a, b, target); });
+        values.resize(count);
+        return values;
+    }
+
+    /**
+     * Bounded max-heap of the 'k' elements nearest to the target seen so far, the farthest of them is on the top.
+     * The vector kernels offer only the candidates, which are not farther than the top, so the heap is rarely touched
+     * once it is full.
+     */
+    class NearestHeap
+    {
+    public:
+        NearestHeap(int target, size_t k) : _target{target}, _k{k}
+        {
+            _values.reserve(k);
+        }
+
+        /**
+         * Returns the distance of the farthest kept element, every element is a candidate until the heap is full.
+         */
+        uint32_t threshold() const
+        {
+            return _values.size() < _k ? UINT32_MAX : distanceTo(_values.front(), _target);
+        }
+
+        void offer(int value)
+        {
+            auto farther = [this](int a, int b) { return isNearer(a, b, _target); }; // the farthest element is the largest one
+            if (_values.size() < _k)
+            {
+                _values.push_back(value);
+                push_heap(_values.begin(), _values.end(), farther);
+            }
+            else if (_k > 0 && isNearer(value, _values.front(), _target))
+            {
+                pop_heap(_values.begin(), _values.end(), farther);
+                _values.back() = value;
+                push_heap(_values.begin(), _values.end(), farther);
+            }
+        }
+
+        vector<int> values() &&
+        {
+            return move(_values);
+        }
+
+    private:
+        int _target;
+        size_t _k;
+        vector<int> _values;
+    };
+
+    vector<int> getNearestRange(const int *data, size_t size, int target, size_t k)
+    {
+        NearestHeap heap(target, k);
+        for (size_t i = 0; i < size; i++)
+        {
+            heap.offer(data[i]);
+        }
+        return move(heap).values();
+    }
+
+    // The distance of 32-bit integers is computed as 'max - min' in the unsigned arithmetic, which cannot overflow.
+    // The candidates, i.e. the elements not farther than the current threshold, are offered to the heap one by one.
+
+    TARGET_SSE41 vector<int> getNearestSSE41Range(const int *data, size_t size, int target, size_t k)
+    {
+        constexpr size_t SIMD_LEN = 4;
+        NearestHeap heap(target, k);
+        __m128i targets = _mm_set1_epi32(target);
+        __m128i threshold = _mm_set1_epi32(static_cast<int>(heap.threshold()));
+        size_t i = 0;
+        for (; i + SIMD_LEN <= size; i += SIMD_LEN)
+        {
+            __m128i batch = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            __m128i distance = _mm_sub_epi32(_mm_max_epi32(batch, targets), _mm_min_epi32(batch, targets));
+            // 'distance <= threshold' as 'max(distance, threshold) == threshold', there is no unsigned comparison in SSE
+            __m128i notFarther = _mm_cmpeq_epi32(_mm_max_epu32(distance, threshold), threshold);
+            uint32_t candidates = _mm_movemask_ps(_mm_castsi128_ps(notFarther));
+            if (candidates != 0)
+            {
+                for (; candidates != 0; candidates &= candidates - 1)
+                {
+                    heap.offer(data[i + countr_zero(candidates)]);
+                }
+                threshold = _mm_set1_epi32(static_cast<int>(heap.threshold()));
+            }
+        }
+        for (; i < size; i++)
+        {
+            heap.offer(data[i]);
+        }
+        return move(heap).values();
+    }
+
+    TARGET_AVX2 vector<int> getNearestAVX2Range(const int *data, size_t size, int target, size_t k)
+    {
+        constexpr size_t SIMD_LEN = 8;
+        NearestHeap heap(target, k);
+        __m256i targets = _mm256_set1_epi32(target);
+        __m256i threshold = _mm256_set1_epi32(static_cast<int>(heap.threshold()));
+        size_t i = 0;
+        for (; i + SIMD_LEN <= size; i += SIMD_LEN)
+        {
+            __m256i batch = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            __m256i distance = _mm256_sub_epi32(_mm256_max_epi32(batch, targets), _mm256_min_epi32(batch, targets));
+            __m256i notFarther = _mm256_cmpeq_epi32(_mm256_max_epu32(distance, threshold), threshold);
+            uint32_t candidates = _mm256_movemask_ps(_mm256_castsi256_ps(notFarther));
+            if (candidates != 0)
+            {
+                for (; candidates != 0; candidates &= candidates - 1)
+                {
+                    heap.offer(data[i + countr_zero(candidates)]);
+                }
+                threshold = _mm256_set1_epi32(static_cast<int>(heap.threshold()));
+            }
+        }
+        for (; i < size; i++)
+        {
+            heap.offer(data[i]);
+        }
+        return move(heap).values();
+    }
+
+    TARGET_AVX512 vector<int> getNearestAVX512Range(const int *data, size_t size, int target, size_t k)
+    {
+        constexpr size_t SIMD_LEN = 16;
+        NearestHeap heap(target, k);
+        __m512i targets = _mm512_set1_epi32(target);
+        __m512i threshold = _mm512_set1_epi32(static_cast<int>(heap.threshold()));
+        size_t i = 0;
+        for (; i + SIMD_LEN <= size; i += SIMD_LEN)
+        {
+            __m512i batch = _mm512_loadu_si512(data + i);
+            // masked variants for the same reason as in 'closerToZeroAVX512'
+            __m512i distance = _mm512_sub_epi32(_mm512_mask_max_epi32(batch, 0xFFFF, batch, targets), _mm512_mask_min_epi32(batch, 0xFFFF, batch, targets));
+            uint32_t candidates = _mm512_cmp_epu32_mask(distance, threshold, _MM_CMPINT_LE);
+            if (candidates != 0)
+            {
+                for (; candidates != 0; candidates &= candidates - 1)
+                {
+                    heap.offer(data[i + countr_zero(candidates)]);
+                }
+                threshold = _mm512_set1_epi32(static_cast<int>(heap.threshold()));
+            }
+        }
+        for (; i < size; i++)
+        {
+            heap.offer(data[i]);
+        }
+        return move(heap).values();
+    }
+
+    /**
+     * Distributes the data among OpenMP threads, finds the nearest elements of each part with the given kernel
+     * and keeps the 'k' nearest of all the parts.
+     */
+    template <vector<int> (*RANGE_KERNEL)(const int *, size_t, int, size_t)>
+    vector<int> getNearestParallel(const int *data, size_t size, int target, size_t k)
+    {
+        k = min(k, size); // the heaps reserve 'k' elements, a huge 'k' must not be allocated
+        vector<vector<int>> threadNearest(omp_get_max_threads());
+        #pragma omp parallel
+        {
+            auto [begin, end] = threadRange(size, omp_get_thread_num(), omp_get_num_threads());
+            if (begin < end) // there may be more threads than elements
+            {
+                // a part cannot contribute more than its own elements
+                threadNearest[omp_get_thread_num()] = RANGE_KERNEL(data + begin, end - begin, target, min(k, end - begin));
+            }
+        }
+
+        vector<int> nearest;
+        for (const vector<int>& part : threadNearest)
+        {
+            nearest.insert(nearest.end(), part.begin(), part.end());
+        }
+        return sortNearest(move(nearest), target, k);
+    }
+
+    /**
+     * Operations on vectors of 'T' used by the AVX-512 kernels of the other element types than 'int', 'Mask' has a bit per lane.
+     * 'closer' is the same 2-key comparison as in 'closerToZeroAVX512', 'nonZero' returns the bitmap of the non-zero lanes.
+     */
+    template <typename T>
+    struct AVX512Lanes;
+
+    template <>
+    struct AVX512Lanes<int8_t>
+    {
+        using Mask = __mmask64;
+        static constexpr size_t LENGTH = 64;
+
+        TARGET_AVX512 static __m512i broadcast(int8_t value) { return _mm512_set1_epi8(value); }
+        TARGET_AVX512 static __m512i load(__m512i source, Mask mask, const int8_t *data) { return _mm512_mask_loadu_epi8(source, mask, data); }
+        TARGET_AVX512 static Mask nonZero(__m512i batch) { return _mm512_test_epi8_mask(batch, batch); }
+
+        TARGET_AVX512 static __m512i closer(__m512i batch, __m512i closest)
+        {
+            // the absolute value of INT8_MIN is 128 as an unsigned number, i.e. correctly the largest distance
+            __m512i absBatch = _mm512_maskz_abs_epi8(UINT64_MAX, batch);
+            __m512i absClosest = _mm512_maskz_abs_epi8(UINT64_MAX, closest);
+            Mask smaller = _mm512_cmp_epu8_mask(absBatch, absClosest, _MM_CMPINT_LT);
+            Mask equal = _mm512_cmp_epu8_mask(absBatch, absClosest, _MM_CMPINT_EQ);
+            Mask larger = _mm512_cmp_epi8_mask(batch, closest, _MM_CMPINT_GT);
+            return _mm512_mask_mov_epi8(closest, smaller | (equal & larger), batch);
+        }
+    };
+
+    template <>
+    struct AVX512Lanes<int16_t>
+    {
+        using Mask = __mmask32;
+        static constexpr size_t LENGTH = 32;
+
+        TARGET_AVX512 static __m512i broadcast(int16_t value) { return _mm512_set1_epi16(value); }
+        TARGET_AVX512 static __m512i load(__m512i source, Mask mask, const int16_t *data) { return _mm512_mask_loadu_epi16(source, mask, data); }
+        TARGET_AVX512 static Mask nonZero(__m512i batch) { return _mm512_test_epi16_mask(batch, batch); }
+
+        TARGET_AVX512 static __m512i closer(__m512i batch, __m512i closest)
+        {
+            __m512i absBatch = _mm512_maskz_abs_epi16(UINT32_MAX, batch);
+            __m512i absClosest = _mm512_maskz_abs_epi16(UINT32_MAX, closest);
+            Mask smaller = _mm512_cmp_epu16_mask(absBatch, absClosest, _MM_CMPINT_LT);
+            Mask equal = _mm512_cmp_epu16_mask(absBatch, absClosest, _MM_CMPINT_EQ);
+            Mask larger = _mm512_cmp_epi16_mask(batch, closest, _MM_CMPINT_GT);
+            return _mm512_mask_mov_epi16(closest, smaller | (equal & larger), batch);
+        }
+    };
+
+    template <>
+    struct AVX512Lanes<int64_t>
+    {
+        using Mask = __mmask8;
+        static constexpr size_t LENGTH = 8;
+
+        TARGET_AVX512 static __m512i broadcast(int64_t value) { return _mm512_set1_epi64(value); }
+        TARGET_AVX512 static __m512i load(__m512i source, Mask mask, const int64_t *data) { return _mm512_mask_loadu_epi64(source, mask, data); }
+        TARGET_AVX512 static Mask nonZero(__m512i batch) { return _mm512_test_epi64_mask(batch, batch); }
+
+        TARGET_AVX512 static __m512i closer(__m512i batch, __m512i closest)
+        {
+            __m512i absBatch = _mm512_maskz_abs_epi64(0xFF, batch);
+            __m512i absClosest = _mm512_maskz_abs_epi64(0xFF, closest);
+            Mask smaller = _mm512_cmp_epu64_mask(absBatch, absClosest, _MM_CMPINT_LT);
+            Mask equal = _mm512_cmp_epu64_mask(absBatch, absClosest, _MM_CMPINT_EQ);
+            Mask larger = _mm512_cmp_epi64_mask(batch, closest, _MM_CMPINT_GT);
+            return _mm512_mask_mov_epi64(closest, smaller | (equal & larger), batch);
+        }
+    };
+
+    template <>
+    struct AVX512Lanes<float>
+    {
+        using Mask = __mmask16;
+        static constexpr size_t LENGTH = 16;
+
+        TARGET_AVX512 static __m512i broadcast(float value) { return _mm512_castps_si512(_mm512_set1_ps(value)); }
+        TARGET_AVX512 static __m512i load(__m512i source, Mask mask, const float *data) { return _mm512_mask_loadu_epi32(source, mask, data); }
+        TARGET_AVX512 static Mask nonZero(__m512i batch) { return _mm512_cmp_ps_mask(_mm512_castsi512_ps(batch), _mm512_setzero_ps(), _CMP_NEQ_UQ); }
+
+        TARGET_AVX512 static __m512i closer(__m512i batch, __m512i closest)
+        {
+            // the bits rotated left by one are the magnitude followed by the sign, see 'isCloserToZero', a single key is enough,
+            // the masked variant of 'rol' for the same reason as of 'abs' in 'closerToZeroAVX512'
+            __m512i keyBatch = _mm512_maskz_rol_epi32(0xFFFF, batch, 1);
+            __m512i keyClosest = _mm512_maskz_rol_epi32(0xFFFF, closest, 1);
+            Mask smaller = _mm512_cmp_epu32_mask(keyBatch, keyClosest, _MM_CMPINT_LT);
+            return _mm512_mask_mov_epi32(closest, smaller, batch);
+        }
+    };
+
+    template <typename T>
+    TARGET_AVX512 T getClosestToZeroLanesRange(const T *data, size_t size)
+    {
+        using Lanes = AVX512Lanes<T>;
+        using Mask = typename Lanes::Mask;
+        __m512i closest = Lanes::broadcast(data[0]);
+
+        // the same masked head and tail as in 'getClosestToZeroAVX512Range'
+        size_t i = headLength(data, size);
+        closest = Lanes::closer(Lanes::load(closest, lowLanes<Mask>(i), data), closest);
+        for (; i + Lanes::LENGTH <= size; i += Lanes::LENGTH)
+        {
+            closest = Lanes::closer(_mm512_loadu_si512(data + i), closest);
+        }
+        closest = Lanes::closer(Lanes::load(closest, lowLanes<Mask>(size - i), data + i), closest);
+
+        alignas(64) T lanes[Lanes::LENGTH];
+        _mm512_store_si512(lanes, closest);
+        return getClosestToZeroRange(lanes, Lanes::LENGTH, lanes[0]);
+    }
+
+    template <typename T>
+    TARGET_AVX512 size_t countChunksLanesRange(const T *data, size_t size)
+    {
+        using Lanes = AVX512Lanes<T>;
+        using Mask = typename Lanes::Mask;
+        size_t chunkCount = 0;
+        uint64_t previousNonZero = 0;
+
+        // the masked out lanes are loaded as zeros, which are not included in the bitmap
+        size_t i = headLength(data, size);
+        chunkCount += countChunkStarts(Lanes::nonZero(Lanes::load(_mm512_setzero_si512(), lowLanes<Mask>(i), data)), previousNonZero, i);
+        for (; i + Lanes::LENGTH <= size; i += Lanes::LENGTH)
+        {
+            chunkCount += countChunkStarts(Lanes::nonZero(_mm512_loadu_si512(data + i)), previousNonZero, Lanes::LENGTH);
+        }
+        size_t tail = size - i;
+        chunkCount += countChunkStarts(Lanes::nonZero(Lanes::load(_mm512_setzero_si512(), lowLanes<Mask>(tail), data + i)), previousNonZero, tail);
+        return chunkCount;
+    }
+
+    // The scalar kernels of the other element types are written, so the compiler can vectorize them for the baseline
+    // instruction set, the chunk starts are counted without the state carried between the iterations and the closest
+    // element is the minimum of a single key, i.e. of the distance followed by the sign like in 'isCloserToZero'.
+
+    template <typename T>
+    size_t countChunksScalarRange(const T *data, size_t size)
+    {
+        size_t chunkCount = size > 0 && data[0] != 0;
+        for (size_t i = 1; i < size; i++)
+        {
+            chunkCount += (data[i] != 0) & (data[i - 1] == 0);
+        }
+        return chunkCount;
+    }
+
+    template <typename T>
+    T getClosestToZeroScalarRange(const T *data, size_t size)
+    {
+        if constexpr (is_floating_point_v<T>)
+        {
+            uint32_t closest = UINT32_MAX;
+            for (size_t i = 0; i < size; i++)
+            {
+                closest = min(closest, rotl(bit_cast<uint32_t>(data[i]), 1));
+            }
+            return bit_cast<T>(rotr(closest, 1));
+        }
+        else if constexpr (sizeof(T) < sizeof(int))
+        {
+            // the distance of the narrow types is at most 32768, so the key fits into 32 bits
+            uint32_t closest = UINT32_MAX;
+            for (size_t i = 0; i < size; i++)
+            {
+                int value = data[i];
+                closest = min(closest, static_cast<uint32_t>(value < 0 ? -value : value) << 1 | (value < 0));
+            }
+            int distance = static_cast<int>(closest >> 1);
+            return static_cast<T>(closest & 1 ? -distance : distance);
+        }
+        else
+        {
+            return getClosestToZeroRange(data, size, data[0]); // the key of 'int64_t' would not fit into 64 bits
+        }
+    }
+
+    /**
+     * Accumulates the chunk related statistics of a range from bitmaps of non-zero elements of its consecutive batches.
+     */
+    struct ChunkAccumulator
+    {
+        size_t size = 0;
+        size_t chunkCount = 0;
+        size_t zeroCount = 0;
+        size_t longestChunk = 0;
+        size_t leadingChunk = 0;
+        size_t run = 0;          // length of the non-zero run at the end of the processed batches
+        bool zeroSeen = false;
+        uint32_t previousNonZero = 0;
+
+        void add(uint32_t nonZeroBitmap, size_t batchLength)
+        {
+            if (batchLength == 0) // masked head or tail without any elements
+            {
+                return;
+            }
+
+            size += batchLength;
+            chunkCount += countChunkStarts(nonZeroBitmap, previousNonZero, batchLength);
+            uint32_t lengthMask = batchLength == 32 ? UINT32_MAX : (1u << batchLength) - 1;
+            if (nonZeroBitmap == lengthMask) // no zero in the batch, which is the common case when zeros are rare
+            {
+                run += batchLength;
+                return;
+            }
+
+            size_t leadingOnes = countr_one(nonZeroBitmap);
+            if (!zeroSeen)
+            {
+                leadingChunk = run + leadingOnes;
+                zeroSeen = true;
+            }
+            zeroCount += popcount(~nonZeroBitmap & lengthMask);
+
+            // the longest run of ones inside the batch, each iteration shortens all runs by one
+            size_t longestInside = 0;
+            for (uint32_t runs = nonZeroBitmap; runs != 0; runs &= runs << 1)
+            {
+                longestInside++;
+            }
+            longestChunk = max({ longestChunk, run + leadingOnes, longestInside });
+            run = countl_one(nonZeroBitmap << (32 - batchLength)); // ones at the end of the batch
+        }
+
+        ScanStatistics finish(int closest, int minimum, int maximum) const
+        {
+            return { closest, minimum, maximum, chunkCount, zeroCount, max(longestChunk, run), size, zeroSeen ? leadingChunk : size, run };
+        }
+    };
+
+    ScanStatistics scanStatisticsRange(const int *data, size_t size)
+    {
+        constexpr size_t BATCH_LEN = 32; // the bitmaps are built from 32 elements, which the compiler can vectorize
+        ChunkAccumulator chunks;
+        int closest = data[0];
+        int minimum = INT_MAX;
+        int maximum = INT_MIN;
+        for (size_t i = 0; i < size; i += BATCH_LEN)
+        {
+            size_t batchLength = min(BATCH_LEN, size - i);
+            uint32_t nonZeroBitmap = 0;
+            for (size_t j = 0; j < batchLength; j++)
+            {
+                int value = data[i + j];
+                nonZeroBitmap |= static_cast<uint32_t>(value != 0) << j;
+                closest = isCloserToZero(value, closest) ? value : closest;
+                minimum = min(minimum, value);
+                maximum = max(maximum, value);
+            }
+            chunks.add(nonZeroBitmap, batchLength);
+        }
+        return chunks.finish(closest, minimum, maximum);
+    }
+
+    TARGET_SSE41 ScanStatistics scanStatisticsSSE41Range(const int *data, size_t size)
+    {
+        constexpr size_t SIMD_LEN = 4;
+        ChunkAccumulator chunks;
+        __m128i closest = _mm_set1_epi32(data[0]);
+        __m128i minimum = closest;
+        __m128i maximum = closest;
+        size_t i = 0;
+        for (; i + SIMD_LEN <= size; i += SIMD_LEN)
+        {
+            __m128i batch = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            closest = closerToZeroSSE41(batch, closest);
+            minimum = _mm_min_epi32(minimum, batch);
+            maximum = _mm_max_epi32(maximum, batch);
+            uint32_t zeroBitmap = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(batch, _mm_setzero_si128())));
+            chunks.add(~zeroBitmap & 0xF, SIMD_LEN);
+        }
+
+        // reduce the lanes, the remaining elements are accumulated one by one
+        alignas(16) int lanes[3][SIMD_LEN];
+        _mm_store_si128(reinterpret_cast<__m128i *>(lanes[0]), closest);
+        _mm_store_si128(reinterpret_cast<__m128i *>(lanes[1]), minimum);
+        _mm_store_si128(reinterpret_cast<__m128i *>(lanes[2]), maximum);
+        int closestValue = getClosestToZeroRange(data + i, size - i, getClosestToZeroRange(lanes[0], SIMD_LEN, lanes[0][0]));
+        int minimumValue = *min_element(lanes[1], lanes[1] + SIMD_LEN);
+        int maximumValue = *max_element(lanes[2], lanes[2] + SIMD_LEN);
+        for (; i < size; i++)
+        {
+            minimumValue = min(minimumValue, data[i]);
+            maximumValue = max(maximumValue, data[i]);
+            chunks.add(data[i] != 0, 1);
+        }
+        return chunks.finish(closestValue, minimumValue, maximumValue);
+    }
+
+    TARGET_AVX2 ScanStatistics scanStatisticsAVX2Range(const int *data, size_t size)
+    {
+        constexpr size_t SIMD_LEN = 8;
+        ChunkAccumulator chunks;
+        __m256i closest = _mm256_set1_epi32(data[0]);
+        __m256i minimum = closest;
+        __m256i maximum = closest;
+        size_t i = 0;
+        for (; i + SIMD_LEN <= size; i += SIMD_LEN)
+        {
+            __m256i batch = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            closest = closerToZeroAVX2(batch, closest);
+            minimum = _mm256_min_epi32(minimum, batch);
+            maximum = _mm256_max_epi32(maximum, batch);
+            uint32_t zeroBitmap = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(batch, _mm256_setzero_si256())));
+            chunks.add(~zeroBitmap & 0xFF, SIMD_LEN);
+        }
+
+        alignas(32) int lanes[3][SIMD_LEN];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(lanes[0]), closest);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(lanes[1]), minimum);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(lanes[2]), maximum);
+        int closestValue = getClosestToZeroRange(data + i, size - i, getClosestToZeroRange(lanes[0], SIMD_LEN, lanes[0][0]));
+        int minimumValue = *min_element(lanes[1], lanes[1] + SIMD_LEN);
+        int maximumValue = *max_element(lanes[2], lanes[2] + SIMD_LEN);
+        for (; i < size; i++)
+        {
+            minimumValue = min(minimumValue, data[i]);
+            maximumValue = max(maximumValue, data[i]);
+            chunks.add(data[i] != 0, 1);
+        }
+        return chunks.finish(closestValue, minimumValue, maximumValue);
+    }
+
+    TARGET_AVX512 ScanStatistics scanStatisticsAVX512Range(const int *data, size_t size)
+    {
+        constexpr size_t SIMD_LEN = 16;
+        ChunkAccumulator chunks;
+        __m512i closest = _mm512_set1_epi32(data[0]);
+        __m512i minimum = closest;
+        __m512i maximum = closest;
+        auto update = [&](__m512i batch, size_t batchLength) TARGET_AVX512
+        {
+            closest = closerToZeroAVX512(batch, closest);
+            minimum = _mm512_mask_min_epi32(minimum, 0xFFFF, minimum, batch); // masked variants for the same reason as in 'closerToZeroAVX512'
+            maximum = _mm512_mask_max_epi32(maximum, 0xFFFF, maximum, batch);
+            chunks.add(_mm512_test_epi32_mask(batch, batch) & laneMask(batchLength), batchLength);
+        };
+
+        // the masked out lanes are loaded from the first element, which is already included in all the statistics
+        __m512i first = _mm512_set1_epi32(data[0]);
+        size_t i = headLength(data, size);
+        update(_mm512_mask_loadu_epi32(first, laneMask(i), data), i);
+        for (; i + SIMD_LEN <= size; i += SIMD_LEN)
+        {
+            update(_mm512_loadu_si512(data + i), SIMD_LEN);
+        }
+        update(_mm512_mask_loadu_epi32(first, laneMask(size - i), data + i), size - i);
+
+        alignas(64) int lanes[3][SIMD_LEN];
+        _mm512_store_si512(lanes[0], closest);
+        _mm512_store_si512(lanes[1], minimum);
+        _mm512_store_si512(lanes[2], maximum);
+        return chunks.finish(getClosestToZeroRange(lanes[0], SIMD_LEN, lanes[0][0]), *min_element(lanes[1], lanes[1] + SIMD_LEN), *max_element(lanes[2], lanes[2] + SIMD_LEN));
+    }
+
+    /**
+     * Distributes the data among OpenMP threads, computes the statistics of each part with the given kernel
+     * and merges them in the order of the parts.
+     */
+    template <ScanStatistics (*RANGE_KERNEL)(const int *, size_t)>
+    ScanStatistics scanStatisticsParallel(const int *data, size_t size)
+    {
+        vector<ScanStatistics> threadStatistics(omp_get_max_threads());
+        #pragma omp parallel
+        {
+            auto [begin, end] = threadRange(size, omp_get_thread_num(), omp_get_num_threads());
+            if (begin < end) // there may be more threads than elements, the default constructed statistics are empty
+            {
+                threadStatistics[omp_get_thread_num()] = RANGE_KERNEL(data + begin, end - begin);
+            }
+        }
+
+        ScanStatistics statistics;
+        for (const ScanStatistics &part : threadStatistics)
+        {
+            statistics = mergeStatistics(statistics, part);
+        }
+        return statistics;
+    }
+}
+
+pair<size_t, size_t> threadRange(size_t size, size_t threadIdx, size_t threadCount)
+{
+    // the first 'size % threadCount' threads get one element more, so no element is left out
+    size_t elementsPerThread = size / threadCount;
+    size_t remainder = size % threadCount;
+    size_t begin = threadIdx * elementsPerThread + min(threadIdx, remainder);
+    return { begin, begin + elementsPerThread + (threadIdx < remainder) };
+}
+
+int getClosestToZeroScalar(const int *data, size_t size)
+{
+    return getClosestToZeroRange(data, size, data[0]);
+}
+
+int getClosestToZeroSSE41(const int *data, size_t size)
+{
+    return getClosestToZeroParallel<getClosestToZeroSSE41Range>(data, size);
+}
+
+int getClosestToZeroAVX2(const int *data, size_t size)
+{
+    return getClosestToZeroParallel<getClosestToZeroAVX2Range>(data, size);
+}
+
+int getClosestToZeroAVX512(const int *data, size_t size)
+{
+    return getClosestToZeroParallel<getClosestToZeroAVX512Range>(data, size);
+}
+
+size_t countChunksScalar(const int *data, size_t size)
+{
+    return countChunksTail(data, size, 0);
+}
+
+size_t countChunksSSE41(const int *data, size_t size)
+{
+    return countChunksParallel<countChunksSSE41Range>(data, size);
+}
+
+size_t countChunksAVX2(const int *data, size_t size)
+{
+    return countChunksParallel<countChunksAVX2Range>(data, size);
+}
+
+size_t countChunksAVX512(const int *data, size_t size)
+{
+    return countChunksParallel<countChunksAVX512Range>(data, size);
+}
+
+vector<int> getNearestScalar(const int *data, size_t size, int target, size_t k)
+{
+    k = min(k, size); // the heap reserves 'k' elements, a huge 'k' must not be allocated
+    return sortNearest(getNearestRange(data, size, target, k), target, k);
+}
+
+vector<int> getNearestSSE41(const int *data, size_t size, int target, size_t k)
+{
+    return getNearestParallel<getNearestSSE41Range>(data, size, target, k);
+}
+
+vector<int> getNearestAVX2(const int *data, size_t size, int target, size_t k)
+{
+    return getNearestParallel<getNearestAVX2Range>(data, size, target, k);
+}
+
+vector<int> getNearestAVX512(const int *data, size_t size, int target, size_t k)
+{
+    return getNearestParallel<getNearestAVX512Range>(data, size, target, k);
+}
+
+template <typename T>
+T getClosestToZeroScalar(const T *data, size_t size)
+{
+    return getClosestToZeroScalarRange(data, size);
+}
+
+template <typename T>
+T getClosestToZeroThreads(const T *data, size_t size)
+{
+    return getClosestToZeroParallel<getClosestToZeroScalarRange<T>>(data, size);
+}
+
+template <typename T>
+T getClosestToZeroAVX512(const T *data, size_t size)
+{
+    return getClosestToZeroParallel<getClosestToZeroLanesRange<T>>(data, size);
+}
+
+template <typename T>
+size_t countChunksScalar(const T *data, size_t size)
+{
+    return countChunksScalarRange(data, size);
+}
+
+template <typename T>
+size_t countChunksThreads(const T *data, size_t size)
+{
+    return countChunksParallel<countChunksScalarRange<T>>(data, size);
+}
+
+template <typename T>
+size_t countChunksAVX512(const T *data, size_t size)
+{
+    return countChunksParallel<countChunksLanesRange<T>>(data, size);
+}
+
+// the element types supported by the '--dtype' switch, 'int' has its own kernels above
+#define INSTANTIATE_ELEMENT_KERNELS(T) \
+    template T getClosestToZeroScalar<T>(const T *, size_t); \
+    template T getClosestToZeroThreads<T>(const T *, size_t); \
+    template T getClosestToZeroAVX512<T>(const T *, size_t); \
+    template size_t countChunksScalar<T>(const T *, size_t); \
+    template size_t countChunksThreads<T>(const T *, size_t); \
+    template size_t countChunksAVX512<T>(const T *, size_t);
+
+INSTANTIATE_ELEMENT_KERNELS(int8_t)
+INSTANTIATE_ELEMENT_KERNELS(int16_t)
+INSTANTIATE_ELEMENT_KERNELS(int64_t)
+INSTANTIATE_ELEMENT_KERNELS(float)
+
+ScanStatistics mergeStatistics(const ScanStatistics& left, const ScanStatistics& right)
+{
+    if (left.size == 0 || right.size == 0) // the empty statistics are the identity
+    {
+        return left.size == 0 ? right : left;
+    }
+
+    bool stitched = left.trailingChunk > 0 && right.leadingChunk > 0; // a chunk continues across the boundary
+    return {
+        isCloserToZero(right.closest, left.closest) ? right.closest : left.closest,
+        min(left.minimum, right.minimum),
+        max(left.maximum, right.maximum),
+        left.chunkCount + right.chunkCount - stitched,
+        left.zeroCount + right.zeroCount,
+        max({ left.longestChunk, right.longestChunk, left.trailingChunk + right.leadingChunk }),
+        left.size + right.size,
+        left.leadingChunk == left.size ? left.size + right.leadingChunk : left.leadingChunk,
+        right.trailingChunk == right.size ? right.size + left.trailingChunk : right.trailingChunk,
+    };
+}
+
+ScanStatistics scanStatisticsScalar(const int *data, size_t size)
+{
+    return size > 0 ? scanStatisticsRange(data, size) : ScanStatistics{};
+}
+
+ScanStatistics scanStatisticsSSE41(const int *data, size_t size)
+{
+    return scanStatisticsParallel<scanStatisticsSSE41Range>(data, size);
+}
+
+ScanStatistics scanStatisticsAVX2(const int *data, size_t size)
+{
+    return scanStatisticsParallel<scanStatisticsAVX2Range>(data, size);
+}
+
+ScanStatistics scanStatisticsAVX512(const int *data, size_t size)
+{
+    return scanStatisticsParallel<scanStatisticsAVX512Range>(data, size);
+}
+
+namespace
+{
+    /**
+     * Sequential sum of the level 'n' of a subtree with a 64-bit accumulator.
+     */
+    int64_t levelSumSubtree(const INode& root, size_t n)
+    {
+        // iterative depth-first traversal with an explicit stack, deep trees cannot overflow the call stack
+        vector<pair<const INode *, size_t>> stack{ { &root, n } };
+        int64_t sum = 0;
+        while (!stack.empty())
+        {
+            auto [node, level] = stack.back();
+            stack.pop_back();
+            if (level == 0) // required level reached, only when 'n' is 0
+            {
+                sum += node->value();
+                continue;
+            }
+
+            if (level == 1) // the children are the required level, they are summed right away instead of going through the stack
+            {
+                for (const auto &child : node->children())
+                {
+                    if (child != nullptr)
+                    {
+                        sum += child->value();
+                    }
+                }
+                continue;
+            }
+            const auto &children = node->children();
+            for (auto child = children.rbegin(); child != children.rend(); ++child) // the first child on the top, the same order as recursion
+            {
+                if (*child != nullptr)
+                {
+                    stack.push_back({ child->get(), level - 1 });
+                }
+            }
+        }
+        return sum;
+    }
+
+    // Tasks are spawned only for the subtrees of the first levels, i.e. hundreds of tasks for a trie of words instead of a task per node.
+    // Subtrees with only a few levels left are not worth a task either, they are summed by the spawning task directly.
+    constexpr size_t TASK_DEPTH = 2;
+    constexpr size_t MIN_TASK_LEVELS = 2;
+
+    // The tasks balance the threads only with enough subtrees at 'TASK_DEPTH', a tree with fewer of them, e.g. a few nodes
+    // at the top fanning out below, is split level by level instead, where every wide level is shared by all the threads.
+    constexpr size_t MIN_TASKS_PER_THREAD = 4;
+
+    /**
+     * Returns the number of the nodes at 'TASK_DEPTH' below the node, i.e. of the subtrees summed by the tasks.
+     */
+    size_t countTaskSubtrees(const INode& node, size_t depth)
+    {
+        if (depth == TASK_DEPTH)
+        {
+            return 1;
+        }
+        size_t count = 0;
+        for (const auto &child : node.children())
+        {
+            if (child != nullptr)
+            {
+                count += countTaskSubtrees(*child, depth + 1);
+            }
+        }
+        return count;
+    }
+
+    struct alignas(64) PartialSum // one per thread, padded to a cache line to avoid false sharing
+    {
+        int64_t value = 0;
+    };
+
+    void levelSumTask(const INode& node, size_t n, size_t depth, vector<PartialSum>& partialSums)
+    {
+        if (depth == TASK_DEPTH || n < MIN_TASK_LEVELS)
+        {
+            partialSums[omp_get_thread_num()].value += levelSumSubtree(node, n);
+            return;
+        }
+
+        for (const auto &child : node.children())
+        {
+            if (child != nullptr)
+            {
+                const INode *childPtr = child.get();
+                #pragma omp task firstprivate(childPtr) shared(partialSums)
+                levelSumTask(*childPtr, n - 1, depth + 1, partialSums);
+            }
+        }
+    }
+
+    /**
+     * Level-synchronous breadth-first traversal, the nodes of each level are split among the threads, which collect the nodes
+     * of the next level. Returns the sums of the levels up to 'maxLevel', or up to the deepest level.
+     */
+    vector<int64_t> levelSumsFrontier(const INode& root, size_t maxLevel)
+    {
+        vector<const INode *> frontier{ &root };
+        vector<int64_t> sums;
+        size_t threadCount = omp_get_max_threads();
+        vector<vector<const INode *>> threadFrontiers(threadCount);
+        vector<PartialSum> partialSums(threadCount);
+
+        while (!frontier.empty())
+        {
+            bool lastLevel = sums.size() == maxLevel;
+            #pragma omp parallel num_threads(threadCount)
+            {
+                size_t threadIdx = omp_get_thread_num();
+                auto [begin, end] = threadRange(frontier.size(), threadIdx, omp_get_num_threads());
+                vector<const INode *> &next = threadFrontiers[threadIdx];
+                next.clear();
+                int64_t sum = 0;
+                for (size_t i = begin; i < end; i++)
+                {
+                    sum += frontier[i]->value();
+                    if (lastLevel)
+                    {
+                        continue;
+                    }
+                    for (const auto &child : frontier[i]->children())
+                    {
+                        if (child != nullptr)
+                        {
+                            next.push_back(child.get());
+                        }
+                    }
+                }
+                partialSums[threadIdx].value = sum;
+            }
+
+            int64_t levelSum = 0;
+            frontier.clear();
+            for (size_t threadIdx = 0; threadIdx < threadCount; threadIdx++) // the nodes of the next level stay in order of the threads
+            {
+                levelSum += partialSums[threadIdx].value;
+                partialSums[threadIdx].value = 0;
+                frontier.insert(frontier.end(), threadFrontiers[threadIdx].begin(), threadFrontiers[threadIdx].end());
+                threadFrontiers[threadIdx].clear();
+            }
+            sums.push_back(levelSum);
+            if (lastLevel)
+            {
+                break;
+            }
+        }
+        return sums;
+    }
+}
+
+int getLevelSumScalar(const INode& root, size_t n)
+{
+    return static_cast<int>(levelSumSubtree(root, n));
+}
+
+int getLevelSumTasks(const INode& root, size_t n)
+{
+    vector<PartialSum> partialSums(omp_get_max_threads());
+    #pragma omp parallel
+    {
+        #pragma omp single // a single thread spawns the tasks, the partial sums are reduced after all the tasks finished
+        levelSumTask(root, n, 0, partialSums);
+    }
+
+    int64_t sum = 0;
+    for (const PartialSum &partialSum : partialSums)
+    {
+        sum += partialSum.value;
+    }
+    return static_cast<int>(sum);
+}
+
+int getLevelSumFrontier(const INode& root, size_t n)
+{
+    vector<int64_t> sums = levelSumsFrontier(root, n);
+    return n < sums.size() ? static_cast<int>(sums[n]) : 0;
+}
+
+int getLevelSumParallel(const INode& root, size_t n)
+{
+    // the top of the tree is visited twice, but it is only a few hundred nodes of the subtrees summed by the tasks
+    size_t threadCount = omp_get_max_threads();
+    bool narrowTop = threadCount > 1 && n >= TASK_DEPTH + MIN_TASK_LEVELS && countTaskSubtrees(root, 0) < MIN_TASKS_PER_THREAD * threadCount;
+    return narrowTop ? getLevelSumFrontier(root, n) : getLevelSumTasks(root, n);
+}
+
+vector<int64_t> getLevelSumsFrontier(const INode& root)
+{
+    return levelSumsFrontier(root, SIZE_MAX);
+}
+
+vector<int64_t> getLevelSumsScalar(const INode& root)
+{
+    // the same traversal as above, but every node contributes to the sum of its level, so all the levels are computed at once
+    vector<int64_t> sums;
+    vector<pair<const INode *, size_t>> stack{ { &root, 0 } };
+    while (!stack.empty())
+    {
+        auto [node, level] = stack.back();
+        stack.pop_back();
+        if (level == sums.size()) // the deepest level so far, levels are discovered one by one
+        {
+            sums.push_back(0);
+        }
+        sums[level] += node->value();
+
+        const auto &children = node->children();
+        for (auto child = children.rbegin(); child != children.rend(); ++child) // the first child on the top, the same order as recursion
+        {
+            if (*child != nullptr)
+            {
+                stack.push_back({ child->get(), level + 1 });
+            }
+        }
+    }
+    return sums;
+}
@@ -0,0 +1,136 @@
+#ifndef _KERNELS_H_
+#define _KERNELS_H_
+
+#include <bit>         // bit_cast, rotl
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "INode.h"
+
+/**
+ * Returns true when 'a' is closer to zero than 'b', a positive value is considered closer than its negative counterpart.
+ * The distance is compared as an unsigned number, so the minimum of a signed type (e.g. INT32_MIN) is handled correctly as well.
+ * A float is compared by its bits rotated left by one, i.e. the magnitude followed by the sign, which orders the magnitudes
+ * like the numbers, prefers 0.0 to -0.0 and puts NaN behind the infinity, so NaN is never closer than a number.
+ */
+template <typename T>
+inline bool isCloserToZero(T a, T b)
+{
+    if constexpr (std::is_floating_point_v<T>)
+    {
+        using Bits = std::conditional_t<sizeof(T) == sizeof(std::uint32_t), std::uint32_t, std::uint64_t>;
+        return std::rotl(std::bit_cast<Bits>(a), 1) < std::rotl(std::bit_cast<Bits>(b), 1);
+    }
+    else
+    {
+        using Unsigned = std::make_unsigned_t<T>;
+        Unsigned absA = a < 0 ? static_cast<Unsigned>(Unsigned{0} - static_cast<Unsigned>(a)) : static_cast<Unsigned>(a);
+        Unsigned absB = b < 0 ? static_cast<Unsigned>(Unsigned{0} - static_cast<Unsigned>(b)) : static_cast<Unsigned>(b);
+        return absA < absB || (absA == absB && a > b);
+    }
+}
+
+/**
+ * Returns the distance of two integers as an unsigned number, which cannot overflow even for INT32_MIN and INT32_MAX.
+ */
+inline uint32_t distanceTo(int value, int target)
+{
+    return value < target ? static_cast<uint32_t>(target) - static_cast<uint32_t>(value) : static_cast<uint32_t>(value) - static_cast<uint32_t>(target);
+}
+
+/**
+ * Returns true when 'a' is nearer to 'target' than 'b', of two equally distant elements the larger one is considered nearer,
+ * i.e. 'isNearer(a, b, 0)' is the same as 'isCloserToZero(a, b)'.
+ */
+inline bool isNearer(int a, int b, int target)
+{
+    uint32_t distanceA = distanceTo(a, target);
+    uint32_t distanceB = distanceTo(b, target);
+    return distanceA < distanceB || (distanceA == distanceB && a > b);
+}
+
+/**
+ * Returns the [begin, end) range of elements processed by a thread with the static partitioning used by the parallel kernels.
+ */
+std::pair<std::size_t, std::size_t> threadRange(std::size_t size, std::size_t threadIdx, std::size_t threadCount);
+
+// Kernels of the 'getClosestToZero' function for each supported instruction set, 'size' must be at least 1.
+// The vector kernels split the data among OpenMP threads.
+int getClosestToZeroScalar(const int *data, std::size_t size);
+int getClosestToZeroSSE41(const int *data, std::size_t size);
+int getClosestToZeroAVX2(const int *data, std::size_t size);
+int getClosestToZeroAVX512(const int *data, std::size_t size);
+
+// Kernels of the 'countChunks' function for each supported instruction set, the vector kernels split the data among OpenMP threads.
+std::size_t countChunksScalar(const int *data, std::size_t size);
+std::size_t countChunksSSE41(const int *data, std::size_t size);
+std::size_t countChunksAVX2(const int *data, std::size_t size);
+std::size_t countChunksAVX512(const int *data, std::size_t size);
+
+// Kernels of both functions for the other element types, i.e. 'int8_t', 'int16_t', 'int64_t' and 'float', instantiated in 'kernels.cpp'.
+// The narrow types fit more lanes into a vector and need less memory bandwidth, so the data are never widened to 'int'.
+// Only AVX-512BW has hand-written vector kernels of all the types, 'Threads' splits the scalar kernel among OpenMP threads instead,
+// the scalar kernels of the types are written, so the compiler can vectorize them for the baseline instruction set.
+// A float chunk consists of the elements, which are not equal to zero, i.e. -0.0 is zero and NaN is not.
+template <typename T> T getClosestToZeroScalar(const T *data, std::size_t size);
+template <typename T> T getClosestToZeroThreads(const T *data, std::size_t size);
+template <typename T> T getClosestToZeroAVX512(const T *data, std::size_t size);
+template <typename T> std::size_t countChunksScalar(const T *data, std::size_t size);
+template <typename T> std::size_t countChunksThreads(const T *data, std::size_t size);
+template <typename T> std::size_t countChunksAVX512(const T *data, std::size_t size);
+
+// Kernels of the 'getNearest' function for each supported instruction set, return the 'k' elements nearest to 'target'
+// (at most 'size') ordered from the nearest one. Each thread of the vector kernels keeps a bounded heap of its part,
+// only the elements not farther than the farthest one in the heap leave the vector registers, the heaps are merged at the end.
+std::vector<int> getNearestScalar(const int *data, std::size_t size, int target, std::size_t k);
+std::vector<int> getNearestSSE41(const int *data, std::size_t size, int target, std::size_t k);
+std::vector<int> getNearestAVX2(const int *data, std::size_t size, int target, std::size_t k);
+std::vector<int> getNearestAVX512(const int *data, std::size_t size, int target, std::size_t k);
+
+/**
+ * Statistics of an array computed in a single pass. Statistics of two neighbouring ranges can be merged,
+ * so each thread (or block of a file) can be processed independently.
+ */
+struct ScanStatistics
+{
+    int closest = 0;                 // element closest to zero, the same as returned by 'getClosestToZero'
+    int minimum = INT32_MAX;
+    int maximum = INT32_MIN;
+    std::size_t chunkCount = 0;      // the same as returned by 'countChunks'
+    std::size_t zeroCount = 0;
+    std::size_t longestChunk = 0;    // number of elements of the longest chunk
+
+    // needed only to merge statistics of neighbouring ranges
+    std::size_t size = 0;            // number of elements, the other statistics are not valid for an empty range
+    std::size_t leadingChunk = 0;    // number of non-zero elements at the beginning of the range
+    std::size_t trailingChunk = 0;   // number of non-zero elements at the end of the range
+};
+
+/**
+ * Returns statistics of the concatenation of the 'left' and the 'right' range.
+ */
+ScanStatistics mergeStatistics(const ScanStatistics& left, const ScanStatistics& right);
+
+// Kernels computing all the statistics in a single pass over the data for each supported instruction set.
+// The vector kernels split the data among OpenMP threads.
+ScanStatistics scanStatisticsScalar(const int *data, std::size_t size);
+ScanStatistics scanStatisticsSSE41(const int *data, std::size_t size);
+ScanStatistics scanStatisticsAVX2(const int *data, std::size_t size);
+ScanStatistics scanStatisticsAVX512(const int *data, std::size_t size);
+
+// The tree traversal is bound by pointer chasing, there is nothing to vectorize, all instruction sets share the same kernels.
+// 'Tasks' spawns OpenMP tasks only for the subtrees of the first levels, each summing into a per-thread partial sum,
+// 'Frontier' processes the tree level by level with the nodes of each level split among the threads, which suits wide trees.
+// 'Parallel' selects between them by the width of the first levels, the frontier is used, when there are too few subtrees
+// for the tasks to balance the threads.
+int getLevelSumScalar(const INode& root, std::size_t n);
+int getLevelSumTasks(const INode& root, std::size_t n);
+int getLevelSumFrontier(const INode& root, std::size_t n);
+int getLevelSumParallel(const INode& root, std::size_t n);
+std::vector<std::int64_t> getLevelSumsScalar(const INode& root);
+std::vector<std::int64_t> getLevelSumsFrontier(const INode& root);
+
+#endif // _KERNELS_H_
@@ -0,0 +1,168 @@
+#include "loader.h"
+#include "kernels.h"
+#include "stats.h"
+
+#include <algorithm>   // fill, min
+#include <stdexcept>
+#include <fcntl.h>     // open
+#include <omp.h>
+#include <sys/mman.h>  // mmap, madvise
+#include <sys/stat.h>  // fstat
+#include <unistd.h>    // pread, close
+
+using namespace std;
+
+/**
+ * Reads the bytes '[begin, end)' of the file to the same offsets of the destination, returns false on an error.
+ */
+static bool readRange(int fileDescriptor, char *destination, size_t begin, size_t end)
+{
+    while (begin < end)
+    {
+        ssize_t count = pread(fileDescriptor, destination + begin, end - begin, begin); // may read less than requested
+        if (count <= 0)
+        {
+            return false;
+        }
+        begin += static_cast<size_t>(count);
+    }
+    return true;
+}
+
+IntegerFile::IntegerFile(const string& fileName, const Options& options) : _buffer{nullptr, AlignedAllocator<int>::Deleter{}}
+{
+    int fileDescriptor;
+    {
+        Stats::Phase phase("open");
+        fileDescriptor = open(fileName.c_str(), O_RDONLY);
+    }
+    if (fileDescriptor < 0)
+    {
+        throw runtime_error("Could not open input file '" + fileName + "'");
+    }
+
+    struct stat fileStat;
+    int statResult;
+    {
+        Stats::Phase phase("size");
+        statResult = fstat(fileDescriptor, &fileStat);
+    }
+    if (statResult != 0)
+    {
+        close(fileDescriptor);
+        throw runtime_error("Could not get the size of input file '" + fileName + "'");
+    }
+    size_t fileBytes = static_cast<size_t>(fileStat.st_size);
+    _size = (fileBytes + sizeof(int) - 1) / sizeof(int); // assume that the file contains only integers
+    _fileBytes = fileBytes;
+
+    try
+    {
+        if (fileBytes > 0) // neither 'mmap' nor the allocator accept an empty range
+        {
+            if (options.loader == Loader::MMAP && options.placement == MemoryPlacement::DEFAULT)
+            {
+                map(fileDescriptor, fileBytes, options);
+            }
+            else
+            {
+                read(fileDescriptor, fileBytes, options.placement);
+            }
+        }
+    }
+    catch (const runtime_error& e)
+    {
+        close(fileDescriptor);
+        throw runtime_error(string(e.what()) + " input file '" + fileName + "'");
+    }
+    close(fileDescriptor); // the mapping stays valid after closing the file
+}
+
+IntegerFile::~IntegerFile()
+{
+    if (_mappedBytes > 0)
+    {
+        munmap(const_cast<int *>(_data), _mappedBytes);
+    }
+}
+
+span<const int> IntegerFile::data() const
+{
+    return { _data, _size };
+}
+
+size_t IntegerFile::fileBytes() const
+{
+    return _fileBytes;
+}
+
+void IntegerFile::map(int fileDescriptor, size_t fileBytes, const Options& options)
+{
+    // the bytes behind the end of the file up to the end of the last page are zero, which pads the last integer
+    Stats::Phase phase("map"); // includes reading of the whole file with 'populate', otherwise the pages are read by the kernels
+    void *mapping = mmap(nullptr, fileBytes, PROT_READ, MAP_PRIVATE | (options.populate ? MAP_POPULATE : 0), fileDescriptor, 0);
+    if (mapping == MAP_FAILED)
+    {
+        throw runtime_error("Could not map");
+    }
+    _data = static_cast<const int *>(mapping);
+    _mappedBytes = fileBytes;
+
+    // the hints are only advisory, e.g. huge pages of the page cache are not supported by all file systems, failures are ignored
+    if (options.hugePages)
+    {
+        madvise(mapping, fileBytes, MADV_HUGEPAGE);
+    }
+    if (options.sequential)
+    {
+        madvise(mapping, fileBytes, MADV_SEQUENTIAL);
+    }
+}
+
+void IntegerFile::read(int fileDescriptor, size_t fileBytes, MemoryPlacement placement)
+{
+    // whole 8-byte elements, so the file can be viewed as an array of 'int64_t' as well, see 'elements'
+    size_t bufferInts = (fileBytes + sizeof(int64_t) - 1) / sizeof(int64_t) * (sizeof(int64_t) / sizeof(int));
+    {
+        Stats::Phase phase("allocate");
+        _buffer.reset(AlignedAllocator<int>{}.allocate(bufferInts)); // not zero-initialized, every byte is overwritten below
+        _data = _buffer.get();
+        if (placement == MemoryPlacement::INTERLEAVE)
+        {
+            interleaveMemory(_buffer.get(), _size * sizeof(int)); // before any page is touched
+        }
+    }
+
+    Stats::Phase phase("read");
+    char *destination = reinterpret_cast<char *>(_buffer.get());
+    if (placement != MemoryPlacement::FIRST_TOUCH)
+    {
+        fill(_buffer.get() + _size - 1, _buffer.get() + bufferInts, 0); // pad the trailing incomplete element
+        if (!readRange(fileDescriptor, destination, 0, fileBytes))
+        {
+            throw runtime_error("Could not read");
+        }
+        return;
+    }
+
+    // each thread reads the part, which it scans in the kernels, so its pages are placed on the node of the thread,
+    // the main thread, i.e. the thread 0, is not pinned by the binding, so it is pinned only for the reading
+    MainThreadPin pin;
+    bool failed = false;
+    #pragma omp parallel reduction(||:failed)
+    {
+        auto [begin, end] = threadRange(_size, omp_get_thread_num(), omp_get_num_threads());
+        if (begin < end) // there may be more threads than integers
+        {
+            if (end == _size)
+            {
+                fill(_buffer.get() + _size - 1, _buffer.get() + bufferInts, 0); // pad the trailing incomplete element
+            }
+            failed = !readRange(fileDescriptor, destination, begin * sizeof(int), min(end * sizeof(int), fileBytes));
+        }
+    }
+    if (failed)
+    {
+        throw runtime_error("Could not read");
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef _LOADER_H_
+#define _LOADER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+
+#include "AlignedAllocator.hpp"
+#include "numa.h"
+
+/**
+ * Binary file of 32-bit integers (in the native endianness) loaded into memory.
+ * The file is either memory-mapped, i.e. the kernels run directly on the page cache without any copy,
+ * or read into a 64-byte aligned buffer, which is not zero-initialized beforehand.
+ * A trailing incomplete integer is padded with zero bytes in both cases, the file can be viewed as an array of another
+ * element type of up to 8 bytes as well, e.g. of 'int16_t', its trailing incomplete element is padded the same way.
+ * The pages of the page cache cannot be placed on the NUMA nodes, so the file is always read with a placement other than the default.
+ */
+class IntegerFile
+{
+public:
+    enum class Loader { MMAP, READ };
+
+    struct Options
+    {
+        Loader loader = Loader::MMAP;
+        bool populate = false;   // prefault all pages at once with 'MAP_POPULATE' instead of on the first access
+        bool hugePages = false;  // advise the kernel to back the mapping with transparent huge pages, fewer TLB misses
+        bool sequential = true;  // advise the kernel to read ahead aggressively, the kernels scan the data sequentially
+        MemoryPlacement placement = MemoryPlacement::DEFAULT;
+    };
+
+    IntegerFile(const std::string& fileName, const Options& options);
+    ~IntegerFile();
+
+    IntegerFile(const IntegerFile&) = delete;
+    IntegerFile& operator=(const IntegerFile&) = delete;
+
+    std::span<const int> data() const;
+    std::size_t fileBytes() const; // may end with an incomplete integer, e.g. of an append in progress
+
+    template <typename T>
+    std::span<const T> elements() const
+    {
+        static_assert(sizeof(T) <= sizeof(std::int64_t), "Only the trailing 8 bytes are padded");
+        return { reinterpret_cast<const T *>(_data), (_fileBytes + sizeof(T) - 1) / sizeof(T) };
+    }
+
+private:
+    const int *_data = nullptr;
+    std::size_t _size = 0;       // number of integers
+    std::size_t _fileBytes = 0;
+    std::size_t _mappedBytes = 0; // length of the mapping, 0 when the file was read or is empty
+    std::unique_ptr<int[], AlignedAllocator<int>::Deleter> _buffer;
+
+    void map(int fileDescriptor, std::size_t fileBytes, const Options& options);
+    void read(int fileDescriptor, std::size_t fileBytes, MemoryPlacement placement);
+};
+
+#endif // _LOADER_H_
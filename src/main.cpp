@@ -2,6 +2,135 @@
 
 using namespace std;
 
+/**
+ * Writes the statistics of test 5 as 'name value' lines, returns false when there are no statistics of an empty input.
+ */
+static bool writeStatistics(ofstream& outputFile, const ScanStatistics& statistics)
+{
+    if (statistics.size == 0)
+    {
+        cerr << "Error: Empty input, statistics need at least one element." << endl;
+        return false;
+    }
+
+    outputFile << "closest " << statistics.closest << "\n"
+               << "chunks " << statistics.chunkCount << "\n"
+               << "min " << statistics.minimum << "\n"
+               << "max " << statistics.maximum << "\n"
+               << "zeros " << statistics.zeroCount << "\n"
+               << "longest_chunk " << statistics.longestChunk << "\n";
+    return true;
+}
+
+/**
+ * Writes the result of test 1, 2 or 5 taken from the statistics of the input, returns false when the input is empty and
+ * the result needs at least one element.
+ */
+static bool writeScanResult(int testNumber, const ScanStatistics& statistics, ofstream& outputFile)
+{
+    if (testNumber == 1)
+    {
+        if (statistics.size == 0)
+        {
+            cerr << "Error: Empty input, closest to zero needs at least one element." << endl;
+            return false;
+        }
+        outputFile << statistics.closest;
+    }
+    else if (testNumber == 2)
+    {
+        outputFile << statistics.chunkCount;
+    }
+    else
+    {
+        return writeStatistics(outputFile, statistics);
+    }
+    return true;
+}
+
+/**
+ * Returns the end of the '--range' of an input of 'size' integers, 'SIZE_MAX' is the end of the input.
+ * Exits, when the range is not inside of the input.
+ */
+static size_t inputRangeEnd(size_t begin, size_t end, size_t size)
+{
+    end = end == SIZE_MAX ? size : end;
+    if (begin > end || end > size)
+    {
+        cerr << "Error: Range [" << begin << ", " << end << ") is not inside of the " << size << " integers of the input." << endl;
+        exit(-1);
+    }
+    return end;
+}
+
+/**
+ * Runs test 1 or 2 on the input file viewed as an array of 'T' instead of 'int', the elements are never widened to 'int'.
+ */
+template <typename T>
+static void runElementTest(int testNumber, span<const T> inputData, ofstream& outputFile)
+{
+    auto start = chrono::high_resolution_clock::now();
+    Stats::Phase phase("compute", true);
+    if (testNumber == 1)
+    {
+        T result;
+        try
+        {
+            result = getClosestToZero(inputData);
+        }
+        catch (const invalid_argument& e)
+        {
+            cerr << "Error: " << e.what() << "." << endl;
+            exit(-1);
+        }
+        // the unary plus writes 'int8_t' as a number instead of a character, a float is written with all its significant digits
+        outputFile << setprecision(numeric_limits<T>::max_digits10) << +result;
+    }
+    else
+    {
+        outputFile << countChunks(inputData);
+    }
+    auto end = chrono::high_resolution_clock::now();
+    cerr << chrono::duration_cast<chrono::milliseconds>(end - start).count() << endl;
+}
+
+/**
+ * Writes the words of the trie of test 3 followed by an empty line and then the codes of their characters followed by an empty line.
+ * The words are written to the standard output, or to a memory-mapped file, when 'wordsPath' is not empty.
+ */
+template<typename TRIE>
+static void exportTrie(const TRIE& trie, const string& wordsPath)
+{
+    cout.flush();
+    int fileDescriptor = wordsPath.empty() ? STDOUT_FILENO : open(wordsPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fileDescriptor < 0)
+    {
+        cerr << "Error: Could not open words file '" << wordsPath << "'." << endl;
+        exit(-1);
+    }
+
+    try
+    {
+        WordWriter writer(fileDescriptor, WordWriter::Format::TEXT, wordsPath.empty() ? WordWriter::Output::WRITE : WordWriter::Output::MMAP);
+        trie.exportWords(writer);
+        writer.writeText("\n");
+        writer.setFormat(WordWriter::Format::ASCII);
+        trie.exportWords(writer);
+        writer.writeText("\n");
+        writer.finish();
+    }
+    catch (const exception& e)
+    {
+        cerr << "Error: " << e.what() << "." << endl;
+        exit(-1);
+    }
+
+    if (!wordsPath.empty())
+    {
+        close(fileDescriptor);
+    }
+}
+
 int main(int argc, char** argv)
 {
     struct
@@ -9,6 +138,26 @@ int main(int argc, char** argv)
         int testNumber = -1; // enum would be better here, but let's keep it simple
         string inputFilePath;
         string outputFilePath;
+        string kernel = "auto";
+        IntegerFile::Options loading;
+        string dtype = "int32";     // element type of the binary input of tests 1 and 2
+        ThreadBinding binding = ThreadBinding::NONE;
+        bool stream = false;
+        size_t blockInts = 4 << 20; // 16 MiB blocks in the streaming mode
+        int target = 0;             // test 6 finds the elements nearest to this value
+        size_t top = 10;            // number of the elements found by test 6
+        size_t rangeBegin = 0;      // tests 1, 2 and 5 process only the integers '[rangeBegin, rangeEnd)'
+        size_t rangeEnd = SIZE_MAX; // the end of the input
+        bool index = false;         // the range is queried with the block index stored next to the input file
+        bool incremental = false;   // only the integers appended since the previous run are processed
+        bool compactTrie = false;
+        bool perLevel = false;      // test 3 sums each level by a separate 'getLevelSum' traversal of the chosen approach
+        string wordsPath;           // the words of test 3 are written to the standard output, when empty
+        bool serve = false;
+        string socketPath;          // the server reads the requests from the standard input, when empty
+        ReversalPlan reversalPlan = ReversalPlan::INSERTION;
+        PlanFormat planFormat = PlanFormat::RAW;
+        string planPath;            // test 4 verifies this plan instead of computing one, when not empty
     } parsedArgs;
 
     // basic argument parsing
@@ -23,14 +172,183 @@ int main(int argc, char** argv)
         {
             parsedArgs.outputFilePath = args[i];
         }
+        else if (args[i] == "--kernel" && ++i < args.size())
+        {
+            parsedArgs.kernel = args[i];
+        }
+        else if (args[i] == "--load" && ++i < args.size())
+        {
+            if (args[i] != "mmap" && args[i] != "read")
+            {
+                cerr << "Error: Loader must be either 'mmap' or 'read', got '" << args[i] << "'." << endl;
+                exit(-1);
+            }
+            parsedArgs.loading.loader = args[i] == "mmap" ? IntegerFile::Loader::MMAP : IntegerFile::Loader::READ;
+        }
+        else if (args[i] == "--populate")
+        {
+            parsedArgs.loading.populate = true;
+        }
+        else if (args[i] == "--huge-pages")
+        {
+            parsedArgs.loading.hugePages = true;
+        }
+        else if (args[i] == "--numa" && ++i < args.size())
+        {
+            if (args[i] != "first-touch" && args[i] != "interleave")
+            {
+                cerr << "Error: NUMA placement must be either 'first-touch' or 'interleave', got '" << args[i] << "'." << endl;
+                exit(-1);
+            }
+            parsedArgs.loading.placement = args[i] == "first-touch" ? MemoryPlacement::FIRST_TOUCH : MemoryPlacement::INTERLEAVE;
+        }
+        else if (args[i] == "--bind" && ++i < args.size())
+        {
+            if (args[i] != "compact" && args[i] != "scatter")
+            {
+                cerr << "Error: Thread binding must be either 'compact' or 'scatter', got '" << args[i] << "'." << endl;
+                exit(-1);
+            }
+            parsedArgs.binding = args[i] == "compact" ? ThreadBinding::COMPACT : ThreadBinding::SCATTER;
+        }
+        else if (args[i] == "--dtype" && ++i < args.size())
+        {
+            if (args[i] != "int8" && args[i] != "int16" && args[i] != "int32" && args[i] != "int64" && args[i] != "float")
+            {
+                cerr << "Error: Element type must be one of 'int8', 'int16', 'int32', 'int64' or 'float', got '" << args[i] << "'." << endl;
+                exit(-1);
+            }
+            parsedArgs.dtype = args[i];
+        }
+        else if (args[i] == "--stream")
+        {
+            parsedArgs.stream = true;
+        }
+        else if (args[i] == "--compact-trie")
+        {
+            parsedArgs.compactTrie = true;
+        }
+        else if (args[i] == "--per-level")
+        {
+            parsedArgs.perLevel = true;
+        }
+        else if (args[i] == "--words" && ++i < args.size())
+        {
+            parsedArgs.wordsPath = args[i];
+        }
+        else if (args[i] == "--serve")
+        {
+            parsedArgs.serve = true;
+        }
+        else if (args[i] == "--socket" && ++i < args.size())
+        {
+            parsedArgs.serve = true;
+            parsedArgs.socketPath = args[i];
+        }
+        else if (args[i] == "--reversal-plan" && ++i < args.size())
+        {
+            if (args[i] != "insertion" && args[i] != "selection")
+            {
+                cerr << "Error: Reversal plan must be either 'insertion' or 'selection', got '" << args[i] << "'." << endl;
+                exit(-1);
+            }
+            parsedArgs.reversalPlan = args[i] == "insertion" ? ReversalPlan::INSERTION : ReversalPlan::SELECTION;
+        }
+        else if (args[i] == "--plan-format" && ++i < args.size())
+        {
+            if (args[i] != "raw" && args[i] != "compact")
+            {
+                cerr << "Error: Plan format must be either 'raw' or 'compact', got '" << args[i] << "'." << endl;
+                exit(-1);
+            }
+            parsedArgs.planFormat = args[i] == "raw" ? PlanFormat::RAW : PlanFormat::COMPACT;
+        }
+        else if (args[i] == "--stats")
+        {
+            Stats::enable(); // before any parallel region, so the counters are inherited by the threads of OpenMP
+        }
+        else if (args[i] == "--verify" && ++i < args.size())
+        {
+            parsedArgs.planPath = args[i];
+        }
+        else if (args[i] == "--block-size" && ++i < args.size())
+        {
+            try
+            {
+                parsedArgs.blockInts = stoull(args[i]);
+                if (parsedArgs.blockInts == 0 || args[i][0] == '-')
+                {
+                    throw invalid_argument(args[i]);
+                }
+            }
+            catch (const logic_error& e) // both 'invalid_argument' and 'out_of_range'
+            {
+                cerr << "Error: Positive number of integers expected after the '--block-size' switch, got '" << args[i] << "'." << endl;
+                exit(-1);
+            }
+        }
+        else if (args[i] == "--target" && ++i < args.size())
+        {
+            try
+            {
+                parsedArgs.target = stoi(args[i]);
+            }
+            catch (const logic_error& e) // both 'invalid_argument' and 'out_of_range'
+            {
+                cerr << "Error: 32-bit integer expected after the '--target' switch, got '" << args[i] << "'." << endl;
+                exit(-1);
+            }
+        }
+        else if (args[i] == "--top" && ++i < args.size())
+        {
+            try
+            {
+                parsedArgs.top = stoull(args[i]);
+                if (args[i][0] == '-')
+                {
+                    throw invalid_argument(args[i]);
+                }
+            }
+            catch (const logic_error& e) // both 'invalid_argument' and 'out_of_range'
+            {
+                cerr << "Error: Number of elements expected after the '--top' switch, got '" << args[i] << "'." << endl;
+                exit(-1);
+            }
+        }
+        else if (args[i] == "--range" && i + 2 < args.size())
+        {
+            try
+            {
+                parsedArgs.rangeBegin = stoull(args[i + 1]);
+                parsedArgs.rangeEnd = stoull(args[i + 2]);
+                if (args[i + 1][0] == '-' || args[i + 2][0] == '-' || parsedArgs.rangeBegin > parsedArgs.rangeEnd)
+                {
+                    throw invalid_argument(args[i]);
+                }
+            }
+            catch (const logic_error& e) // both 'invalid_argument' and 'out_of_range'
+            {
+                cerr << "Error: Begin and end of the range expected after the '--range' switch, got '" << args[i + 1] << " " << args[i + 2] << "'." << endl;
+                exit(-1);
+            }
+            i += 2;
+        }
+        else if (args[i] == "--index")
+        {
+            parsedArgs.index = true;
+        }
+        else if (args[i] == "--incremental")
+        {
+            parsedArgs.incremental = true;
+        }
         else if (args[i] == "-t" && ++i < args.size())
         {
             try
             {
                 parsedArgs.testNumber = stoi(args[i]);
-                if (parsedArgs.testNumber < 1 || parsedArgs.testNumber > 4)
+                if (parsedArgs.testNumber < 1 || parsedArgs.testNumber > 6)
                 {
-                    cerr << "Error: Test number must be between 1 and 4 inclusive, got '" << args[i] << "'." << endl;
+                    cerr << "Error: Test number must be between 1 and 6 inclusive, got '" << args[i] << "'." << endl;
                     exit(-1);
                 }
             }
@@ -47,64 +365,337 @@ int main(int argc, char** argv)
         }
     }
 
+    // the threads are pinned before any data is loaded, so the pages touched by a thread stay on its node
+    try
+    {
+        bindThreads(parsedArgs.binding);
+    }
+    catch (const exception& e)
+    {
+        cerr << "Error: " << e.what() << "." << endl;
+        exit(-1);
+    }
+
+    if (parsedArgs.serve)
+    {
+        // the datasets are loaded once and kept in memory, the input and output files are given with each request
+        try
+        {
+            selectKernelSet(parsedArgs.kernel);
+            QueryServer server(parsedArgs.loading);
+            if (parsedArgs.socketPath.empty())
+            {
+                server.serve(STDIN_FILENO, STDOUT_FILENO);
+            }
+            else
+            {
+                server.listen(parsedArgs.socketPath);
+            }
+        }
+        catch (const exception& e)
+        {
+            cerr << "Error: " << e.what() << "." << endl;
+            exit(-1);
+        }
+        return 0;
+    }
+
     if (parsedArgs.inputFilePath.empty() || parsedArgs.outputFilePath.empty() || parsedArgs.testNumber == -1)
     {
         cerr << "Error: Missing required arguments." << endl;
         exit(-1);
     }
 
-    ofstream outputFile(parsedArgs.outputFilePath, ios::binary);
+    if (parsedArgs.stream && parsedArgs.testNumber != 1 && parsedArgs.testNumber != 2 && parsedArgs.testNumber != 5)
+    {
+        cerr << "Error: Streaming mode is supported only by tests 1, 2 and 5." << endl;
+        exit(-1);
+    }
+
+    if (parsedArgs.dtype != "int32" && (parsedArgs.stream || (parsedArgs.testNumber != 1 && parsedArgs.testNumber != 2)))
+    {
+        cerr << "Error: Other element types than 'int32' are supported only by tests 1 and 2 without the streaming mode." << endl;
+        exit(-1);
+    }
+
+    bool ranged = parsedArgs.rangeBegin != 0 || parsedArgs.rangeEnd != SIZE_MAX || parsedArgs.index;
+    if (ranged && (parsedArgs.stream || parsedArgs.dtype != "int32" || (parsedArgs.testNumber != 1 && parsedArgs.testNumber != 2 && parsedArgs.testNumber != 5)))
+    {
+        cerr << "Error: Ranges and the block index are supported only by tests 1, 2 and 5 of 'int32' without the streaming mode." << endl;
+        exit(-1);
+    }
+
+    if (parsedArgs.incremental && (ranged || parsedArgs.stream || parsedArgs.dtype != "int32" || (parsedArgs.testNumber != 1 && parsedArgs.testNumber != 2 && parsedArgs.testNumber != 5)))
+    {
+        cerr << "Error: Incremental mode is supported only by tests 1, 2 and 5 of 'int32' without the streaming mode and ranges." << endl;
+        exit(-1);
+    }
+
+    // the processed integers are skipped only in a lazily memory-mapped file, the other loadings read the whole file
+    if (parsedArgs.incremental && (parsedArgs.loading.loader != IntegerFile::Loader::MMAP || parsedArgs.loading.populate
+                                   || parsedArgs.loading.placement != MemoryPlacement::DEFAULT))
+    {
+        cerr << "Error: Incremental mode cannot be combined with '--load read', '--populate' or '--numa', they read the whole file." << endl;
+        exit(-1);
+    }
+
+    if (parsedArgs.perLevel && (parsedArgs.testNumber != 3 || parsedArgs.compactTrie))
+    {
+        cerr << "Error: Level sums by separate traversals are supported only by test 3 without the compact trie." << endl;
+        exit(-1);
+    }
+
+    if (!parsedArgs.planPath.empty() && parsedArgs.testNumber != 4)
+    {
+        cerr << "Error: Only plans of test 4 can be verified." << endl;
+        exit(-1);
+    }
+
+    try
+    {
+        selectKernelSet(parsedArgs.kernel); // has an effect only with the default build, i.e. without '_APPROACH_N_'
+    }
+    catch (const invalid_argument& e)
+    {
+        cerr << "Error: " << e.what() << "." << endl;
+        exit(-1);
+    }
+
+    int exitCode = 0; // 1 when a verified plan does not sort the input
+    ofstream outputFile;
+    {
+        Stats::Phase phase("open");
+        outputFile.open(parsedArgs.outputFilePath, ios::binary);
+    }
     if (!outputFile.is_open())
     {
         cerr << "Error: Could not open output file '" << parsedArgs.outputFilePath << "'." << endl;
         exit(-1);
     }
 
-    if (parsedArgs.testNumber == 3)
-    {
-        Trie trie(parsedArgs.inputFilePath);
-        trie.print();
-        cout << endl;
-        trie.printASCII();
-        cout << endl;
-
-        outputFile << getLevelSum(trie, 0) << endl;
-        outputFile << getLevelSum(trie, 1) << endl;
-        outputFile << getLevelSum(trie, 2) << endl;
-        outputFile << getLevelSum(trie, 3) << endl;
-        outputFile << getLevelSum(trie, 4) << endl;
-        outputFile << getLevelSum(trie, 5) << endl;
-        outputFile << getLevelSum(trie, 6) << endl;
-        outputFile << getLevelSum(trie, 7) << endl;
-        outputFile << getLevelSum(trie, 8) << endl;
-        outputFile << getLevelSum(trie, 9) << endl;
-        outputFile << getLevelSum(trie, 10) << endl;
-        outputFile << getLevelSum(trie, 11) << endl;
-        outputFile << getLevelSum(trie, 123) << endl;
+    if (parsedArgs.testNumber == 3 && parsedArgs.compactTrie)
+    {
+        // the same output as below, the level sums are read directly from the contiguous levels of the compact trie
+        CompactTrie trie = [&] { Stats::Phase phase("build"); return CompactTrie(parsedArgs.inputFilePath); }();
+        {
+            Stats::Phase phase("export");
+            exportTrie(trie, parsedArgs.wordsPath);
+        }
+
+        Stats::Phase phase("compute", true);
+        for (size_t level : { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 123 })
+        {
+            outputFile << trie.levelSum(level) << endl;
+        }
     }
-    else
+    else if (parsedArgs.testNumber == 3)
+    {
+        Trie trie = [&] { Stats::Phase phase("build"); return Trie(parsedArgs.inputFilePath); }();
+        {
+            Stats::Phase phase("export");
+            exportTrie(trie, parsedArgs.wordsPath); // buffered, there is no system call per word
+        }
+
+        if (parsedArgs.perLevel)
+        {
+            // a traversal per reported level, i.e. the 'getLevelSum' of the approach the binary was built with
+            Stats::Phase phase("compute", true);
+            for (size_t level : { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 123 })
+            {
+                outputFile << getLevelSum(trie, level) << endl;
+            }
+        }
+        else
+        {
+            // all the levels are summed in a single traversal of the trie instead of a traversal per reported level
+            vector<int64_t> levelSums;
+            {
+                Stats::Phase phase("compute", true);
+                levelSums = getLevelSums(trie);
+            }
+            for (size_t level : { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 123 })
+            {
+                outputFile << (level < levelSums.size() ? levelSums[level] : 0) << endl;
+            }
+        }
+    }
+    else if (parsedArgs.stream)
+    {
+        // out-of-core mode, the file is read in blocks by a separate thread and each block is processed as soon as it is read
+        try
+        {
+            auto start = chrono::high_resolution_clock::now();
+            Stats::Phase phase("compute", true); // includes reading of the blocks
+            if (parsedArgs.testNumber == 1)
+            {
+                outputFile << getClosestToZeroStreamed(parsedArgs.inputFilePath, parsedArgs.blockInts);
+            }
+            else if (parsedArgs.testNumber == 2)
+            {
+                outputFile << countChunksStreamed(parsedArgs.inputFilePath, parsedArgs.blockInts);
+            }
+            else
+            {
+                if (!writeStatistics(outputFile, scanStatisticsStreamed(parsedArgs.inputFilePath, parsedArgs.blockInts)))
+                {
+                    exit(-1);
+                }
+            }
+            auto end = chrono::high_resolution_clock::now();
+            cerr << chrono::duration_cast<chrono::milliseconds>(end - start).count() << endl; // includes reading, which overlaps with the computation
+        }
+        catch (const exception& e)
+        {
+            cerr << "Error: " << e.what() << "." << endl;
+            exit(-1);
+        }
+    }
+    else if (parsedArgs.dtype != "int32")
+    {
+        // the same loading as below, the file is only viewed as an array of another element type
+        unique_ptr<IntegerFile> inputFile;
+        try
+        {
+            inputFile = make_unique<IntegerFile>(parsedArgs.inputFilePath, parsedArgs.loading);
+        }
+        catch (const runtime_error& e)
+        {
+            cerr << "Error: " << e.what() << "." << endl;
+            exit(-1);
+        }
+
+        if (parsedArgs.dtype == "int8")
+        {
+            runElementTest(parsedArgs.testNumber, inputFile->elements<int8_t>(), outputFile);
+        }
+        else if (parsedArgs.dtype == "int16")
+        {
+            runElementTest(parsedArgs.testNumber, inputFile->elements<int16_t>(), outputFile);
+        }
+        else if (parsedArgs.dtype == "int64")
+        {
+            runElementTest(parsedArgs.testNumber, inputFile->elements<int64_t>(), outputFile);
+        }
+        else
+        {
+            runElementTest(parsedArgs.testNumber, inputFile->elements<float>(), outputFile);
+        }
+    }
+    else if (parsedArgs.incremental)
+    {
+        // the statistics of the previous runs are read from the state file, only the appended integers are scanned,
+        // the memory-mapped pages of the already processed integers are never touched
+        unique_ptr<IntegerFile> inputFile;
+        try
+        {
+            inputFile = make_unique<IntegerFile>(parsedArgs.inputFilePath, parsedArgs.loading);
+        }
+        catch (const runtime_error& e)
+        {
+            cerr << "Error: " << e.what() << "." << endl;
+            exit(-1);
+        }
+        // an incomplete trailing integer, e.g. of an append in progress, is left for the next run
+        span<const int> inputData = inputFile->data().first(inputFile->fileBytes() / sizeof(int));
+
+        unique_ptr<IngestState> state;
+        {
+            Stats::Phase phase("state");
+            state = make_unique<IngestState>(parsedArgs.inputFilePath, inputData);
+        }
+
+        auto start = chrono::high_resolution_clock::now();
+        {
+            Stats::Phase phase("compute", true);
+            state->update(inputData);
+        }
+        auto end = chrono::high_resolution_clock::now();
+        try
+        {
+            Stats::Phase phase("state");
+            state->save();
+        }
+        catch (const runtime_error& e)
+        {
+            cerr << "Error: " << e.what() << "." << endl;
+            exit(-1);
+        }
+        if (!writeScanResult(parsedArgs.testNumber, state->statistics(), outputFile))
+        {
+            exit(-1);
+        }
+
+        cerr << chrono::duration_cast<chrono::milliseconds>(end - start).count() << endl;
+    }
+    else if (parsedArgs.index)
     {
-        ifstream inputFile(parsedArgs.inputFilePath, ios::binary);
-        if (!inputFile.is_open())
+        // the statistics of the range are merged from the summaries of the blocks, only the blocks at the ends of the range are scanned
+        unique_ptr<IntegerFile> inputFile;
+        try
+        {
+            inputFile = make_unique<IntegerFile>(parsedArgs.inputFilePath, parsedArgs.loading);
+        }
+        catch (const runtime_error& e)
+        {
+            cerr << "Error: " << e.what() << "." << endl;
+            exit(-1);
+        }
+        span<const int> inputData = inputFile->data();
+        size_t rangeEnd = inputRangeEnd(parsedArgs.rangeBegin, parsedArgs.rangeEnd, inputData.size());
+
+        unique_ptr<BlockIndex> index;
+        try
+        {
+            Stats::Phase phase("index"); // reading of the index, or building and storing of a missing or out of date one
+            index = make_unique<BlockIndex>(BlockIndex::open(inputData, parsedArgs.inputFilePath));
+        }
+        catch (const runtime_error& e)
         {
-            cerr << "Error: Could not open input file '" << parsedArgs.inputFilePath << "'." << endl;
+            cerr << "Error: " << e.what() << "." << endl;
             exit(-1);
         }
-        inputFile.seekg(0, ios::end);
-        size_t fileSizeInts = (static_cast<size_t>(inputFile.tellg()) + sizeof(int) - 1) / sizeof(int); // assume that the file contains only integers
-        inputFile.seekg(0, ios::beg);
-        vector<int, AlignedAllocator<int>> inputVectorAligned(fileSizeInts);              // reserve space for the vector
-        vector<int> &inputVector = reinterpret_cast<vector<int> &>(inputVectorAligned); // this should be avoided...
-        inputFile.read(reinterpret_cast<char *>(inputVector.data()), fileSizeInts * sizeof(int)); // assume that the endianness is correct
-        inputFile.close();
 
+        auto start = chrono::high_resolution_clock::now();
+        ScanStatistics statistics;
+        {
+            Stats::Phase phase("compute", true);
+            statistics = index->query(parsedArgs.rangeBegin, rangeEnd);
+        }
+        auto end = chrono::high_resolution_clock::now();
+        if (!writeScanResult(parsedArgs.testNumber, statistics, outputFile))
+        {
+            exit(-1);
+        }
+
+        cerr << chrono::duration_cast<chrono::milliseconds>(end - start).count() << endl;
+    }
+    else
+    {
+        // the kernels run directly on the memory-mapped file by default, i.e. there is no copy and no zero-initialization of a buffer
+        unique_ptr<IntegerFile> inputFile;
+        try
+        {
+            inputFile = make_unique<IntegerFile>(parsedArgs.inputFilePath, parsedArgs.loading);
+        }
+        catch (const runtime_error& e)
+        {
+            cerr << "Error: " << e.what() << "." << endl;
+            exit(-1);
+        }
+        span<const int> inputData = inputFile->data();
+        size_t rangeEnd = inputRangeEnd(parsedArgs.rangeBegin, parsedArgs.rangeEnd, inputData.size());
+        inputData = inputData.subspan(parsedArgs.rangeBegin, rangeEnd - parsedArgs.rangeBegin); // the whole input by default
 
         switch (parsedArgs.testNumber)
         {
         case 1:
             {
                 auto start = chrono::high_resolution_clock::now();
-                int result = getClosestToZero(inputVector);
+                int result;
+                {
+                    Stats::Phase phase("compute", true);
+                    result = getClosestToZero(inputData);
+                }
                 auto end = chrono::high_resolution_clock::now();
                 auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
                 outputFile << result; // write the result to the output file in ASCII
@@ -116,7 +707,11 @@ int main(int argc, char** argv)
         case 2:
             {
                 auto start = chrono::high_resolution_clock::now();
-                int result = countChunks(inputVector);
+                size_t result;
+                {
+                    Stats::Phase phase("compute", true);
+                    result = countChunks(inputData);
+                }
                 auto end = chrono::high_resolution_clock::now();
                 auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
                 outputFile << result; // write the result to the output file in ASCII
@@ -126,15 +721,100 @@ int main(int argc, char** argv)
             break;
         
         case 4:
-            {// scope for the local variable
-                vector<size_t> reversals = getReversalsToSort(inputVector);
-                // write the result to the output file in binary
-                outputFile.write(reinterpret_cast<char *>(reversals.data()), reversals.size() * sizeof(size_t));
+            if (!parsedArgs.planPath.empty())
+            {
+                // the reversals of the plan are applied to the input as they are decoded, the format is detected from the file
+                ifstream planFile(parsedArgs.planPath, ios::binary);
+                if (!planFile.is_open())
+                {
+                    cerr << "Error: Could not open plan file '" << parsedArgs.planPath << "'." << endl;
+                    exit(-1);
+                }
+                auto start = chrono::high_resolution_clock::now();
+                bool sorted = false;
+                try
+                {
+                    Stats::Phase phase("compute", true); // includes reading and decoding of the plan
+                    PlanReader reader(planFile);
+                    sorted = isSortedByReversals(inputData, reader);
+                }
+                catch (const exception& e)
+                {
+                    cerr << "Error: " << e.what() << "." << endl;
+                    exit(-1);
+                }
+                auto end = chrono::high_resolution_clock::now();
+                outputFile << (sorted ? "sorted" : "unsorted") << endl;
+
+                cerr << chrono::duration_cast<chrono::milliseconds>(end - start).count() << endl;
+                exitCode = sorted ? 0 : 1;
+            }
+            else
+            {
+                // the plan is written to the output file in binary as it is produced, either raw or compact, see 'plan.h'
+                try
+                {
+                    Stats::Phase phase("compute", true); // includes encoding and writing of the plan
+                    PlanWriter writer(outputFile, parsedArgs.planFormat);
+                    writeReversalsToSort(inputData, parsedArgs.reversalPlan, writer);
+                    writer.finish();
+                }
+                catch (const exception& e)
+                {
+                    cerr << "Error: " << e.what() << "." << endl;
+                    exit(-1);
+                }
+            }
+            break;
+
+        case 5:
+            {
+                // all the statistics computed in a single pass, i.e. the data are read from the memory only once
+                auto start = chrono::high_resolution_clock::now();
+                ScanStatistics statistics;
+                {
+                    Stats::Phase phase("compute", true);
+                    statistics = activeKernelSet().scanStatistics(inputData.data(), inputData.size());
+                }
+                auto end = chrono::high_resolution_clock::now();
+                if (!writeStatistics(outputFile, statistics))
+                {
+                    exit(-1);
+                }
+
+                cerr << chrono::duration_cast<chrono::milliseconds>(end - start).count() << endl;
+            }
+            break;
+
+        case 6:
+            {
+                // the 'top' elements nearest to the target, a bounded heap per thread instead of sorting the whole array
+                auto start = chrono::high_resolution_clock::now();
+                vector<int> nearest;
+                {
+                    Stats::Phase phase("compute", true);
+                    nearest = getNearest(inputData, parsedArgs.target, parsedArgs.top);
+                }
+                auto end = chrono::high_resolution_clock::now();
+                for (int value : nearest)
+                {
+                    outputFile << value << "\n";
+                }
+
+                cerr << chrono::duration_cast<chrono::milliseconds>(end - start).count() << endl;
             }
             break;
         }
     }
-    outputFile.close();
 
-    return 0;
+    {
+        Stats::Phase phase("write"); // the results are buffered until the file is closed
+        outputFile.close();
+    }
+
+    if (Stats::enabled())
+    {
+        Stats::report(cerr); // a single line of JSON after the time of the test
+    }
+    return exitCode;
 }
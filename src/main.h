@@ -2,14 +2,30 @@
 #define _MAIN_H_
 
 #include "assignment.h"
+#include "block_index.h"
+#include "dispatch.h"
+#include "export.h"
+#include "ingest.h"
 #include "AlignedAllocator.hpp"
+#include "compact_trie.h"
+#include "loader.h"
+#include "numa.h"
+#include "server.h"
+#include "stats.h"
+#include "stream.h"
 #include "trie.h"
 
 #include <iostream>
 #include <vector>
 #include <string>
 #include <fstream>
+#include <iomanip>  // setprecision
+#include <limits>
 #include <omp.h>
 #include <chrono>
+#include <memory>
+#include <span>
+#include <fcntl.h>  // open
+#include <unistd.h> // STDIN_FILENO, STDOUT_FILENO, close
 
 #endif // _MAIN_H_
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include "numa.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>             // sscanf
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <linux/mempolicy.h>  // MPOL_INTERLEAVE
+#include <omp.h>
+#include <sched.h>            // sched_getaffinity, sched_setaffinity
+#include <sys/syscall.h>      // SYS_mbind
+#include <unistd.h>           // syscall, sysconf
+
+using namespace std;
+
+namespace
+{
+    const string NODE_DIR = "/sys/devices/system/node/";
+    int mainCpu = -1; // CPU of the OpenMP thread 0 of the binding, -1 when the threads are not bound
+
+    /**
+     * Parses a list of numbers in the format of the sysfs, e.g. '0-3,8,10-11', returns an empty list when the file does not exist.
+     */
+    vector<int> readList(const string& path)
+    {
+        vector<int> list;
+        ifstream file(path);
+        string range;
+        while (getline(file, range, ','))
+        {
+            int first;
+            int last;
+            int count = sscanf(range.c_str(), "%d-%d", &first, &last);
+            if (count < 1)
+            {
+                continue; // e.g. an empty list
+            }
+            for (int number = first; number <= (count == 2 ? last : first); number++)
+            {
+                list.push_back(number);
+            }
+        }
+        return list;
+    }
+
+    /**
+     * Returns the CPUs allowed for the process grouped by the NUMA nodes, the nodes without any allowed CPU are left out.
+     */
+    vector<vector<int>> getNodeCpus()
+    {
+        cpu_set_t allowed;
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        {
+            throw runtime_error("Could not get the CPUs of the process");
+        }
+
+        vector<vector<int>> nodes;
+        for (int node : readList(NODE_DIR + "online"))
+        {
+            vector<int> cpus;
+            for (int cpu : readList(NODE_DIR + "node" + to_string(node) + "/cpulist"))
+            {
+                if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+                {
+                    cpus.push_back(cpu);
+                }
+            }
+            if (!cpus.empty())
+            {
+                nodes.push_back(move(cpus));
+            }
+        }
+
+        if (nodes.empty()) // no NUMA information, e.g. a kernel without 'CONFIG_NUMA'
+        {
+            nodes.emplace_back();
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            {
+                if (CPU_ISSET(cpu, &allowed))
+                {
+                    nodes.back().push_back(cpu);
+                }
+            }
+        }
+        return nodes;
+    }
+}
+
+vector<int> getBindingCpus(ThreadBinding binding)
+{
+    vector<vector<int>> nodes = getNodeCpus();
+    vector<int> cpus;
+    if (binding == ThreadBinding::SCATTER)
+    {
+        size_t longest = 0;
+        for (const vector<int>& node : nodes)
+        {
+            longest = max(longest, node.size());
+        }
+        // the 'i'-th CPU of each node before the 'i + 1'-th CPU of any node
+        for (size_t i = 0; i < longest; i++)
+        {
+            for (const vector<int>& node : nodes)
+            {
+                if (i < node.size())
+                {
+                    cpus.push_back(node[i]);
+                }
+            }
+        }
+    }
+    else
+    {
+        for (const vector<int>& node : nodes)
+        {
+            cpus.insert(cpus.end(), node.begin(), node.end());
+        }
+    }
+    return cpus;
+}
+
+void bindThreads(ThreadBinding binding)
+{
+    if (binding == ThreadBinding::NONE)
+    {
+        return;
+    }
+
+    vector<int> cpus = getBindingCpus(binding);
+    cpu_set_t mainSet; // the OpenMP thread 0 is the main thread
+    bool failed = sched_getaffinity(0, sizeof(mainSet), &mainSet) != 0;
+    #pragma omp parallel reduction(||:failed)
+    {
+        // more threads than CPUs, e.g. with 'OMP_NUM_THREADS', share the CPUs in the same order
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpus[omp_get_thread_num() % cpus.size()], &set);
+        failed = sched_setaffinity(0, sizeof(set), &set) != 0; // 0 is the calling thread, not the whole process
+    }
+
+    // the threads created later by the main thread inherit its mask, e.g. 'execution::par' sizes the pool of TBB by it,
+    // so a single CPU would serialize them, the main thread stays on all the CPUs of the process instead
+    failed = failed || sched_setaffinity(0, sizeof(mainSet), &mainSet) != 0;
+    if (failed)
+    {
+        throw runtime_error("Could not pin the threads to the CPUs");
+    }
+    mainCpu = cpus[0];
+}
+
+MainThreadPin::MainThreadPin()
+{
+    if (mainCpu < 0 || sched_getaffinity(0, sizeof(_mask), &_mask) != 0)
+    {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(mainCpu, &set);
+    _pinned = sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+MainThreadPin::~MainThreadPin()
+{
+    if (_pinned)
+    {
+        sched_setaffinity(0, sizeof(_mask), &_mask);
+    }
+}
+
+void interleaveMemory(void *data, size_t bytes)
+{
+    vector<int> nodes = readList(NODE_DIR + "has_memory");
+    if (nodes.size() < 2)
+    {
+        return; // there is nothing to interleave
+    }
+
+    vector<unsigned long> mask(nodes.back() / 64 + 1);
+    for (int node : nodes)
+    {
+        mask[node / 64] |= 1UL << (node % 64);
+    }
+
+    // only whole pages can have a policy, the partial pages at the ends are placed by the first touch
+    uintptr_t pageBytes = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    uintptr_t begin = (reinterpret_cast<uintptr_t>(data) + pageBytes - 1) / pageBytes * pageBytes;
+    uintptr_t end = (reinterpret_cast<uintptr_t>(data) + bytes) / pageBytes * pageBytes;
+    if (begin < end)
+    {
+        // the kernel reads 'maxnode - 1' bits of the mask
+        syscall(SYS_mbind, begin, end - begin, MPOL_INTERLEAVE, mask.data(), mask.size() * 64 + 1, 0);
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef _NUMA_H_
+#define _NUMA_H_
+
+#include <cstddef>
+#include <vector>
+#include <sched.h> // cpu_set_t
+
+/**
+ * Placement of the threads and of the loaded data on the NUMA nodes, see '--bind' and '--numa'.
+ *
+ * The parallel kernels split the data statically with 'threadRange', i.e. the thread 'i' always scans the same part.
+ * When the threads are pinned and the pages of each part are first touched by the thread, which scans it later,
+ * every thread reads only the memory of its own node. The topology is read from '/sys/devices/system/node' and
+ * the system calls are used directly, so there is no dependency on 'libnuma'. A machine without the NUMA information
+ * is treated as a single node with all the CPUs.
+ */
+enum class ThreadBinding
+{
+    NONE,    // the threads are scheduled by the operating system
+    COMPACT, // consecutive threads on consecutive CPUs, one node is filled before the next one
+    SCATTER  // consecutive threads on different nodes in a round-robin, all the memory controllers are used by fewer threads
+};
+
+enum class MemoryPlacement
+{
+    DEFAULT,     // the pages are placed on the node of the thread, which touches them first, i.e. the loading thread
+    FIRST_TOUCH, // the data is loaded in parallel, each thread loads its own 'threadRange' part
+    INTERLEAVE   // the pages are distributed among the nodes with memory in a round-robin
+};
+
+/**
+ * Returns the CPUs allowed for the process in the order, in which they are assigned to the threads by the binding.
+ */
+std::vector<int> getBindingCpus(ThreadBinding binding);
+
+/**
+ * Pins each OpenMP thread except of the main one to a single CPU, the thread 'i' to the 'i'-th CPU of 'getBindingCpus'.
+ * The threads of OpenMP are created by this call and reused by all the following parallel regions with the default number
+ * of threads, so it must be called before the data is loaded. The main thread, i.e. the OpenMP thread 0, keeps the CPUs
+ * of the process, because the threads created later, e.g. of 'execution::par' or the reader of the streaming mode,
+ * inherit its mask and would all share a single CPU otherwise, see 'MainThreadPin' for the loading of its part of the data.
+ * Does nothing with 'ThreadBinding::NONE', throws 'runtime_error' when the affinity cannot be set.
+ */
+void bindThreads(ThreadBinding binding);
+
+/**
+ * Pins the calling thread, i.e. the main thread, to the CPU of the OpenMP thread 0 of the last 'bindThreads' until the scope
+ * ends and restores its mask then, e.g. while it first touches its part of the data, so the part is placed on the same node
+ * as the parts of the other threads. The pinning is only advisory, a failure leaves the thread on its CPUs.
+ * Does nothing, when the threads are not bound.
+ */
+class MainThreadPin
+{
+public:
+    MainThreadPin();
+    ~MainThreadPin();
+
+    MainThreadPin(const MainThreadPin&) = delete;
+    MainThreadPin& operator=(const MainThreadPin&) = delete;
+
+private:
+    bool _pinned = false;
+    cpu_set_t _mask; // the mask restored at the end, valid only when pinned
+};
+
+/**
+ * Sets the interleaving policy for the whole pages of the not yet touched memory range. The policy is only advisory,
+ * so a failure, e.g. in a container without the permission, leaves the default placement.
+ */
+void interleaveMemory(void *data, std::size_t bytes);
+
+#endif // _NUMA_H_
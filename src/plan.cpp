@@ -0,0 +1,182 @@
+#include "plan.h"
+
+#include <algorithm>
+#include <cstring>   // memcpy, memcmp
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace
+{
+    constexpr size_t MAX_VARINT_BYTES = 10; // 64 bits in 7-bit groups
+
+    inline uint64_t zigzag(int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    inline int64_t unzigzag(uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+}
+
+PlanWriter::PlanWriter(ostream& output, PlanFormat format, size_t bufferBytes)
+    : _output{output}, _format{format}
+{
+    bufferBytes = max(bufferBytes, size_t{4096});
+    _buffer.reset(new char[bufferBytes]);
+    _position = _buffer.get();
+    _end = _buffer.get() + bufferBytes - MAX_VARINT_BYTES;
+
+    if (_format == PlanFormat::COMPACT)
+    {
+        memcpy(_position, PLAN_MAGIC, sizeof(PLAN_MAGIC));
+        _position += sizeof(PLAN_MAGIC);
+    }
+}
+
+PlanWriter::~PlanWriter()
+{
+    try
+    {
+        finish();
+    }
+    catch (const exception& e)
+    {
+        // destructors must not throw, call 'finish' explicitly to handle the errors
+    }
+}
+
+void PlanWriter::write(size_t reversal)
+{
+    if (_position > _end)
+    {
+        flush();
+    }
+
+    if (_format == PlanFormat::RAW)
+    {
+        memcpy(_position, &reversal, sizeof(reversal));
+        _position += sizeof(reversal);
+        return;
+    }
+
+    // the difference wraps around for reversals above INT64_MAX, the decoder wraps it back
+    uint64_t value = zigzag(static_cast<int64_t>(reversal - _previous));
+    _previous = reversal;
+    while (value >= 0x80)
+    {
+        *_position++ = static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    *_position++ = static_cast<char>(value);
+}
+
+void PlanWriter::finish()
+{
+    if (_buffer == nullptr)
+    {
+        return; // already finished
+    }
+    flush();
+    _output.flush();
+    _buffer.reset();
+    if (!_output)
+    {
+        throw runtime_error("Writing of the plan failed");
+    }
+}
+
+void PlanWriter::flush()
+{
+    _output.write(_buffer.get(), _position - _buffer.get());
+    _position = _buffer.get();
+    if (!_output)
+    {
+        throw runtime_error("Writing of the plan failed");
+    }
+}
+
+PlanReader::PlanReader(istream& input, size_t bufferBytes)
+    : _input{input}, _bufferBytes{max(bufferBytes, sizeof(PLAN_MAGIC))}
+{
+    _buffer.reset(new char[_bufferBytes]);
+    uint8_t byte;
+    if (!readByte(byte))
+    {
+        return; // an empty plan in the raw format
+    }
+    _position--; // the first read fills the buffer with at least the magic, unless the stream is shorter
+
+    if (_end - _position >= static_cast<ptrdiff_t>(sizeof(PLAN_MAGIC)) && memcmp(_position, PLAN_MAGIC, sizeof(PLAN_MAGIC)) == 0)
+    {
+        _format = PlanFormat::COMPACT;
+        _position += sizeof(PLAN_MAGIC);
+    }
+}
+
+PlanFormat PlanReader::format() const
+{
+    return _format;
+}
+
+bool PlanReader::next(size_t& reversal)
+{
+    uint8_t byte;
+    if (!readByte(byte))
+    {
+        return false;
+    }
+
+    if (_format == PlanFormat::RAW)
+    {
+        // the bytes of a reversal may be split between two reads
+        char bytes[sizeof(size_t)] = { static_cast<char>(byte) };
+        for (size_t i = 1; i < sizeof(size_t); i++)
+        {
+            if (!readByte(byte))
+            {
+                throw runtime_error("Plan ends inside of a reversal, it is not a sequence of 8-byte reversals");
+            }
+            bytes[i] = static_cast<char>(byte);
+        }
+        memcpy(&reversal, bytes, sizeof(reversal));
+        return true;
+    }
+
+    uint64_t value = byte & 0x7F;
+    for (unsigned shift = 7; byte & 0x80; shift += 7)
+    {
+        if (shift >= 64 || !readByte(byte))
+        {
+            throw runtime_error("Plan ends inside of a reversal or the reversal is too long");
+        }
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    }
+    reversal = _previous + static_cast<size_t>(unzigzag(value));
+    _previous = reversal;
+    return true;
+}
+
+bool PlanReader::readByte(uint8_t& byte)
+{
+    if (_position == _end)
+    {
+        _input.read(_buffer.get(), _bufferBytes);
+        if (_input.bad())
+        {
+            throw runtime_error("Reading of the plan failed");
+        }
+        _position = _buffer.get();
+        _end = _position + _input.gcount();
+        if (_position == _end)
+        {
+            return false;
+        }
+    }
+    byte = static_cast<uint8_t>(*_position++);
+    return true;
+}
@@ -0,0 +1,81 @@
+#ifndef _PLAN_H_
+#define _PLAN_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+
+/**
+ * File formats of the reversal plans of 'getReversalsToSort'.
+ *
+ * 'PlanFormat::RAW' is the original output of test 4, each reversal is an 8-byte integer in the native endianness.
+ * 'PlanFormat::COMPACT' starts with the 8-byte 'PLAN_MAGIC' followed by the differences of the consecutive reversals (the first
+ * one from 0), each difference is zigzag encoded, i.e. small negative numbers become small positive numbers,
+ * and written as a variable-length integer, 7 bits per byte from the lowest ones, the highest bit marks a following byte.
+ * The consecutive reversals of the plans are close to each other, so most of them take 1 to 3 bytes instead of 8.
+ * The magic as a raw reversal would be longer than any array, so the formats are told apart by the first 8 bytes.
+ */
+enum class PlanFormat { RAW, COMPACT };
+
+constexpr char PLAN_MAGIC[8] = { 'R', 'V', 'P', 'L', 'A', 'N', '1', '\n' };
+
+/**
+ * Streaming encoder of a plan, the reversals are buffered and written to the stream as they are produced,
+ * so the whole plan does not have to be kept in memory.
+ */
+class PlanWriter
+{
+public:
+    PlanWriter(std::ostream& output, PlanFormat format, std::size_t bufferBytes = 1 << 20);
+    ~PlanWriter(); // calls 'finish', errors are ignored
+
+    PlanWriter(const PlanWriter&) = delete;
+    PlanWriter& operator=(const PlanWriter&) = delete;
+
+    void write(std::size_t reversal);
+    void finish(); // writes out the buffered reversals, throws 'runtime_error' when writing fails
+
+private:
+    std::ostream& _output;
+    PlanFormat _format;
+    std::unique_ptr<char[]> _buffer;
+    char *_position;
+    char *_end; // leaves space for the longest encoded reversal
+    std::size_t _previous = 0;
+
+    void flush();
+};
+
+/**
+ * Streaming decoder of a plan in any of the formats, the format is detected from the beginning of the stream.
+ */
+class PlanReader
+{
+public:
+    PlanReader(std::istream& input, std::size_t bufferBytes = 1 << 20);
+
+    PlanReader(const PlanReader&) = delete;
+    PlanReader& operator=(const PlanReader&) = delete;
+
+    PlanFormat format() const;
+
+    /**
+     * Reads the next reversal, returns false at the end of the plan.
+     * Throws 'runtime_error' when the stream ends inside of a reversal or the stream cannot be read.
+     */
+    bool next(std::size_t& reversal);
+
+private:
+    std::istream& _input;
+    PlanFormat _format = PlanFormat::RAW;
+    std::size_t _bufferBytes;
+    std::unique_ptr<char[]> _buffer;
+    const char *_position = nullptr;
+    const char *_end = nullptr;
+    std::size_t _previous = 0;
+
+    bool readByte(std::uint8_t& byte); // refills the buffer when it is empty, returns false at the end of the stream
+};
+
+#endif // _PLAN_H_
@@ -0,0 +1,352 @@
+#include "server.h"
+#include "assignment.h"
+
+#include <cerrno>
+#include <csignal>      // signal
+#include <cstring>      // strerror
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <sys/socket.h> // socket, bind, listen, accept
+#include <sys/un.h>     // sockaddr_un
+#include <unistd.h>     // read, write, close, unlink
+
+using namespace std;
+
+namespace
+{
+    /**
+     * Writes the whole buffer, returns false when the peer is gone.
+     */
+    bool writeAll(int fd, const string& buffer)
+    {
+        size_t written = 0;
+        while (written < buffer.size())
+        {
+            ssize_t result = write(fd, buffer.data() + written, buffer.size() - written);
+            if (result < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (result <= 0)
+            {
+                return false;
+            }
+            written += static_cast<size_t>(result);
+        }
+        return true;
+    }
+}
+
+QueryServer::QueryServer(const IntegerFile::Options& loading) : _loading{loading} { }
+
+bool QueryServer::serve(int inputFd, int outputFd)
+{
+    constexpr size_t READ_SIZE = 64 << 10;
+    vector<char> readBuffer(READ_SIZE);
+    string pending;   // received, but not yet complete request
+    string responses; // responses of the current batch
+
+    bool endOfInput = false;
+    Action action = Action::CONTINUE;
+    while (!endOfInput && action == Action::CONTINUE)
+    {
+        ssize_t received = read(inputFd, readBuffer.data(), readBuffer.size());
+        if (received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (received <= 0)
+        {
+            endOfInput = true; // a request without the final new line is still answered
+            if (!pending.empty())
+            {
+                pending.push_back('\n');
+            }
+        }
+        else
+        {
+            pending.append(readBuffer.data(), static_cast<size_t>(received));
+        }
+
+        // all the complete requests received so far form a batch, their responses are sent with a single write
+        size_t begin = 0;
+        size_t end;
+        while (action == Action::CONTINUE && (end = pending.find('\n', begin)) != string::npos)
+        {
+            string request = pending.substr(begin, end - begin);
+            if (!request.empty() && request.back() == '\r')
+            {
+                request.pop_back();
+            }
+            begin = end + 1;
+            if (!request.empty())
+            {
+                action = execute(request, responses);
+            }
+        }
+        pending.erase(0, begin);
+
+        if (!responses.empty())
+        {
+            if (!writeAll(outputFd, responses))
+            {
+                break;
+            }
+            responses.clear();
+        }
+    }
+
+    return action != Action::SHUTDOWN;
+}
+
+void QueryServer::listen(const string& socketPath)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path))
+    {
+        throw runtime_error("Socket path '" + socketPath + "' is too long");
+    }
+    socketPath.copy(address.sun_path, socketPath.size());
+
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0)
+    {
+        throw runtime_error(string("Could not create a socket: ") + strerror(errno));
+    }
+    unlink(socketPath.c_str()); // remove a stale socket of a previous run
+    if (bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || ::listen(listenFd, SOMAXCONN) != 0)
+    {
+        string error = strerror(errno);
+        close(listenFd);
+        throw runtime_error("Could not listen on socket '" + socketPath + "': " + error);
+    }
+    signal(SIGPIPE, SIG_IGN); // a client closing its connection early must not terminate the server
+
+    // the kernels already use all the cores, so the clients are served one after another
+    bool running = true;
+    while (running)
+    {
+        int clientFd = accept(listenFd, nullptr, nullptr);
+        if (clientFd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            break;
+        }
+        running = serve(clientFd, clientFd);
+        close(clientFd);
+    }
+
+    close(listenFd);
+    unlink(socketPath.c_str());
+}
+
+QueryServer::Action QueryServer::execute(const string& request, string& response)
+{
+    istringstream tokens(request);
+    string command;
+    tokens >> command;
+
+    ostringstream result;
+    try
+    {
+        if (command == "quit" || command == "shutdown")
+        {
+            response += "ok\n";
+            return command == "quit" ? Action::QUIT : Action::SHUTDOWN;
+        }
+
+        string fileName;
+        if (!(tokens >> fileName))
+        {
+            throw invalid_argument("Missing file name of '" + command + "'");
+        }
+
+        if (command == "closest")
+        {
+            span<const int> data = integerFile(fileName).data();
+            if (data.empty())
+            {
+                throw invalid_argument("Empty input, closest to zero needs at least one element");
+            }
+            result << getClosestToZero(data);
+        }
+        else if (command == "chunks")
+        {
+            result << countChunks(integerFile(fileName).data());
+        }
+        else if (command == "nearest")
+        {
+            string target;
+            string k;
+            // only the target may have a sign, 'stoull' would wrap a negative number of elements around to a huge one
+            bool parsed = static_cast<bool>(tokens >> target >> k);
+            if (!parsed || target == "-" || target.find_first_not_of("0123456789", target[0] == '-' ? 1 : 0) != string::npos
+                || k[0] == '-' || k.find_first_not_of("0123456789") != string::npos)
+            {
+                throw invalid_argument("Target and number of elements expected after the file name of 'nearest'");
+            }
+            vector<int> nearest = getNearest(integerFile(fileName).data(), stoi(target), stoull(k));
+            for (size_t i = 0; i < nearest.size(); i++)
+            {
+                result << (i > 0 ? " " : "") << nearest[i];
+            }
+        }
+        else if (command == "range")
+        {
+            string begin;
+            string end;
+            if (!(tokens >> begin >> end) || begin.find_first_not_of("0123456789") != string::npos || end.find_first_not_of("0123456789") != string::npos)
+            {
+                throw invalid_argument("Begin and end of the range expected after the file name of 'range'");
+            }
+            ScanStatistics statistics = blockIndex(fileName).query(stoull(begin), stoull(end));
+            if (statistics.size == 0)
+            {
+                throw invalid_argument("Empty range, closest to zero needs at least one element");
+            }
+            result << statistics.closest << " " << statistics.chunkCount;
+        }
+        else if (command == "reversals")
+        {
+            vector<size_t> reversals = getReversalsToSort(integerFile(fileName).data());
+            for (size_t i = 0; i < reversals.size(); i++)
+            {
+                result << (i > 0 ? " " : "") << reversals[i];
+            }
+        }
+        else if (command == "levelsum")
+        {
+            vector<size_t> levels;
+            string level;
+            while (tokens >> level)
+            {
+                if (level.find_first_not_of("0123456789") != string::npos)
+                {
+                    throw invalid_argument("Unsigned level expected, got '" + level + "'");
+                }
+                levels.push_back(stoull(level));
+            }
+            if (levels.empty())
+            {
+                throw invalid_argument("Missing level of 'levelsum'");
+            }
+
+            auto dictionary = _dictionaries.find(fileName);
+            if (dictionary != _dictionaries.end()) // the level sums of an updated dictionary are maintained by the trie
+            {
+                for (size_t i = 0; i < levels.size(); i++)
+                {
+                    result << (i > 0 ? " " : "") << dictionary->second->levelSum(levels[i]);
+                }
+            }
+            else
+            {
+                const vector<int64_t>& sums = levelSums(fileName);
+                for (size_t i = 0; i < levels.size(); i++)
+                {
+                    result << (i > 0 ? " " : "") << (levels[i] < sums.size() ? sums[levels[i]] : 0);
+                }
+            }
+        }
+        else if (command == "insert" || command == "erase")
+        {
+            string word;
+            if (!(tokens >> word))
+            {
+                throw invalid_argument("Missing word of '" + command + "'");
+            }
+
+            unique_ptr<Trie>& dictionary = _dictionaries[fileName];
+            if (dictionary == nullptr)
+            {
+                try
+                {
+                    dictionary = make_unique<Trie>(fileName);
+                }
+                catch (...)
+                {
+                    _dictionaries.erase(fileName);
+                    throw;
+                }
+                _levelSums.erase(fileName); // outdated after the update
+            }
+            result << (command == "insert" ? dictionary->insert(word) : dictionary->erase(word));
+        }
+        else if (command == "load")
+        {
+            result << integerFile(fileName).data().size();
+        }
+        else if (command == "unload")
+        {
+            _blockIndices.erase(fileName); // refers to the data of the file
+            _integerFiles.erase(fileName);
+            _levelSums.erase(fileName);
+            _dictionaries.erase(fileName);
+        }
+        else
+        {
+            throw invalid_argument("Unknown command '" + command + "'");
+        }
+    }
+    catch (const exception& e) // e.g. a missing file or an out of range level, the server keeps running
+    {
+        response += string("error ") + e.what() + "\n";
+        return Action::CONTINUE;
+    }
+
+    string value = result.str();
+    response += value.empty() ? "ok\n" : "ok " + value + "\n";
+    return Action::CONTINUE;
+}
+
+const IntegerFile& QueryServer::integerFile(const string& fileName)
+{
+    unique_ptr<IntegerFile>& file = _integerFiles[fileName];
+    if (file == nullptr)
+    {
+        try
+        {
+            file = make_unique<IntegerFile>(fileName, _loading);
+        }
+        catch (...)
+        {
+            _integerFiles.erase(fileName); // do not cache the failure, the file may appear later
+            throw;
+        }
+    }
+    return *file;
+}
+
+const BlockIndex& QueryServer::blockIndex(const string& fileName)
+{
+    unique_ptr<BlockIndex>& index = _blockIndices[fileName];
+    if (index == nullptr)
+    {
+        try
+        {
+            index = make_unique<BlockIndex>(BlockIndex::open(integerFile(fileName).data(), fileName));
+        }
+        catch (...)
+        {
+            _blockIndices.erase(fileName);
+            throw;
+        }
+    }
+    return *index;
+}
+
+const vector<int64_t>& QueryServer::levelSums(const string& fileName)
+{
+    auto found = _levelSums.find(fileName);
+    if (found == _levelSums.end())
+    {
+        // the compact trie needs a fraction of the memory of 'Trie', it is released right after, the level sums are all the server needs
+        found = _levelSums.emplace(fileName, CompactTrie(fileName).levelSums()).first;
+    }
+    return found->second;
+}
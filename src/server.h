@@ -0,0 +1,74 @@
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "block_index.h"
+#include "compact_trie.h"
+#include "loader.h"
+#include "trie.h"
+
+/**
+ * Long-running query server, which keeps the datasets in memory between requests, so the per-query latency
+ * does not include the process startup, reading of the input file or building of the trie.
+ *
+ * The protocol is line based, each request is a single line of space separated tokens and is answered by a single line,
+ * either 'ok <result>' or 'error <message>'. The responses are in the order of the requests:
+ *   closest <file>                   -- 'getClosestToZero' of a binary file of integers
+ *   chunks <file>                    -- 'countChunks' of a binary file of integers
+ *   nearest <file> <target> <k>      -- 'getNearest' of a binary file of integers, space separated from the nearest one
+ *   range <file> <begin> <end>       -- 'getClosestToZero' and 'countChunks' of the integers '[begin, end)' of a binary file,
+ *                                       answered from the block index of the file, see 'block_index.h'
+ *   reversals <file>                 -- 'getReversalsToSort' of a binary file of integers, space separated
+ *   levelsum <file> <level>...       -- 'getLevelSum' of a trie built from a text file for each of the levels
+ *   insert <file> <word>             -- adds the word to the dictionary of a text file, returns 1 when it was not present, else 0
+ *   erase <file> <word>              -- removes the word from the dictionary of a text file, returns 1 when it was present, else 0
+ *   load <file>                      -- loads a binary file in advance, returns its number of integers
+ *   unload <file>                    -- releases the binary file, its block index, the level sums and the dictionary of the file
+ *   quit                             -- closes the connection
+ *   shutdown                         -- closes the connection and stops the server
+ * Files are loaded on their first use and are identified by their path, i.e. changes of a loaded file are not detected.
+ * Only the sums of all the levels are kept of a trie, they are computed right after building a compact trie of the file.
+ * The first update of a dictionary builds a 'Trie' of the file instead, which keeps the level sums up to date with the updates.
+ * The file itself is not modified.
+ *
+ * Requests can be pipelined, i.e. a client can send many requests without waiting for the responses. All the requests
+ * received at once are processed as a batch and their responses are sent back with a single write.
+ */
+class QueryServer
+{
+public:
+    QueryServer(const IntegerFile::Options& loading);
+
+    /**
+     * Serves requests read from 'inputFd' and writes the responses to 'outputFd' until the end of the input,
+     * 'quit' or 'shutdown'. Returns false after 'shutdown'.
+     */
+    bool serve(int inputFd, int outputFd);
+
+    /**
+     * Listens on a Unix domain socket and serves the connected clients one after another until 'shutdown'.
+     * Throws 'runtime_error' when the socket cannot be created.
+     */
+    void listen(const std::string& socketPath);
+
+private:
+    enum class Action { CONTINUE, QUIT, SHUTDOWN };
+
+    IntegerFile::Options _loading;
+    std::map<std::string, std::unique_ptr<IntegerFile>> _integerFiles;
+    std::map<std::string, std::unique_ptr<BlockIndex>> _blockIndices; // of the loaded binary files
+    std::map<std::string, std::vector<std::int64_t>> _levelSums;
+    std::map<std::string, std::unique_ptr<Trie>> _dictionaries; // updated dictionaries
+
+    Action execute(const std::string& request, std::string& response);
+    const IntegerFile& integerFile(const std::string& fileName);
+    const BlockIndex& blockIndex(const std::string& fileName);
+    const std::vector<std::int64_t>& levelSums(const std::string& fileName);
+};
+
+#endif // _SERVER_H_
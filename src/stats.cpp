@@ -0,0 +1,159 @@
+#include "stats.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>             // strerror
+#include <ostream>
+#include <string>
+#include <vector>
+#include <linux/perf_event.h>  // perf_event_attr, PERF_*
+#include <sys/syscall.h>       // SYS_perf_event_open
+#include <unistd.h>            // syscall, read
+
+using namespace std;
+
+namespace
+{
+    constexpr size_t COUNTER_COUNT = 4;
+
+    struct Counter
+    {
+        const char *name;
+        uint32_t type;
+        uint64_t config;
+    };
+
+    // the cache events are encoded as the cache, the operation and the result in the lowest 3 bytes
+    constexpr Counter COUNTERS[COUNTER_COUNT] = {
+        { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { "llc_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+        { "dtlb_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    };
+
+    struct PhaseRecord
+    {
+        string name;
+        size_t calls = 0;
+        int64_t nanoseconds = 0;
+        bool counted = false;              // the counters were read for the phase
+        uint64_t counts[COUNTER_COUNT] = {};
+    };
+
+    vector<PhaseRecord> records;           // in the order of the first start of the phases, there are only a few of them
+    int counterFds[COUNTER_COUNT] = { -1, -1, -1, -1 };
+    string counterStatus = "none";         // names of the opened counters, or why they could not be opened
+
+    int64_t now()
+    {
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    PhaseRecord& record(const char *name)
+    {
+        for (PhaseRecord &phase : records)
+        {
+            if (phase.name == name)
+            {
+                return phase;
+            }
+        }
+        return records.emplace_back(PhaseRecord{ name });
+    }
+
+    /**
+     * Returns the value of the counter, scaled up when the kernel multiplexed more events than the CPU can count at once.
+     */
+    uint64_t readCounter(size_t counter)
+    {
+        uint64_t values[3] = {}; // value, time enabled, time running
+        if (counterFds[counter] < 0 || ::read(counterFds[counter], values, sizeof(values)) != sizeof(values) || values[2] == 0)
+        {
+            return 0;
+        }
+        return values[2] < values[1] ? static_cast<uint64_t>(static_cast<double>(values[0]) * values[1] / values[2]) : values[0];
+    }
+}
+
+void Stats::enable()
+{
+    _enabled = true;
+
+    string opened;
+    string failure;
+    for (size_t i = 0; i < COUNTER_COUNT; i++)
+    {
+        perf_event_attr attributes{};
+        attributes.size = sizeof(attributes);
+        attributes.type = COUNTERS[i].type;
+        attributes.config = COUNTERS[i].config;
+        attributes.inherit = 1;        // the threads created later are counted as well
+        attributes.exclude_kernel = 1; // allowed without privileges with the default 'perf_event_paranoid'
+        attributes.exclude_hv = 1;
+        attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // the calling process on any CPU
+        counterFds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+        if (counterFds[i] >= 0)
+        {
+            if (!opened.empty())
+            {
+                opened += ',';
+            }
+            opened += COUNTERS[i].name;
+        }
+        else if (failure.empty())
+        {
+            failure = string(COUNTERS[i].name) + ": " + strerror(errno); // e.g. no counters in a virtual machine
+        }
+    }
+    counterStatus = opened.empty() ? "none (" + failure + ")" : opened;
+}
+
+void Stats::Phase::begin()
+{
+    record(_name); // the phases are reported in the order of their start
+    if (_counters)
+    {
+        for (size_t i = 0; i < COUNTER_COUNT; i++)
+        {
+            _startCounts[i] = readCounter(i);
+        }
+    }
+    _startNanoseconds = now(); // the counters are not read within the timed interval
+}
+
+void Stats::Phase::end()
+{
+    int64_t nanoseconds = now() - _startNanoseconds;
+    PhaseRecord& phase = record(_name);
+    phase.calls++;
+    phase.nanoseconds += nanoseconds;
+    if (_counters)
+    {
+        phase.counted = true;
+        for (size_t i = 0; i < COUNTER_COUNT; i++)
+        {
+            phase.counts[i] += readCounter(i) - _startCounts[i];
+        }
+    }
+}
+
+void Stats::report(ostream& output)
+{
+    output << "{\"phases\":[";
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const PhaseRecord& phase = records[i];
+        output << (i > 0 ? "," : "") << "{\"name\":\"" << phase.name << "\",\"calls\":" << phase.calls << ",\"ns\":" << phase.nanoseconds;
+        for (size_t counter = 0; counter < COUNTER_COUNT && phase.counted; counter++)
+        {
+            if (counterFds[counter] >= 0)
+            {
+                output << ",\"" << COUNTERS[counter].name << "\":" << phase.counts[counter];
+            }
+        }
+        output << "}";
+    }
+    output << "],\"counters\":\"" << counterStatus << "\"}" << endl;
+}
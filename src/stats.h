@@ -0,0 +1,71 @@
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <cstdint>
+#include <iosfwd>
+
+/**
+ * Opt-in instrumentation of the phases of a run, e.g. opening, reading and processing of the input, see '--stats'.
+ *
+ * A phase is timed by a 'Stats::Phase' object living for the duration of the phase, the times of phases with the same name
+ * are added up. The hardware counters of the process (cycles, instructions, last level cache and data TLB misses)
+ * are read by 'perf_event_open' at the beginning and at the end of the phases, which request them, usually the kernels.
+ * The counters are inherited by the threads created after 'enable', so the threads of OpenMP are counted as well.
+ *
+ * Nothing is measured until 'enable' is called, a disabled phase only tests a flag, i.e. there is no clock read,
+ * no system call and no allocation in the hot path.
+ */
+class Stats
+{
+public:
+    /**
+     * Starts collecting the statistics and opens the counters, which are supported by the CPU, the kernel and its
+     * 'perf_event_paranoid' setting. Must be called before any parallel region, otherwise the threads are not counted.
+     */
+    static void enable();
+    static bool enabled() { return _enabled; }
+
+    class Phase
+    {
+    public:
+        Phase(const char *name, bool counters = false) : _name{name}, _counters{counters}
+        {
+            if (_enabled)
+            {
+                begin();
+            }
+        }
+
+        ~Phase()
+        {
+            if (_enabled)
+            {
+                end();
+            }
+        }
+
+        Phase(const Phase&) = delete;
+        Phase& operator=(const Phase&) = delete;
+
+    private:
+        const char *_name;
+        bool _counters;
+        std::int64_t _startNanoseconds = 0;
+        std::uint64_t _startCounts[4] = {};
+
+        void begin();
+        void end();
+    };
+
+    /**
+     * Writes the collected statistics as a single line of JSON, e.g.
+     * {"phases":[{"name":"read","calls":1,"ns":1200},{"name":"compute","calls":1,"ns":800,"cycles":2100,...}],"counters":"..."}
+     * The counters, which could not be opened, are left out, 'counters' describes why.
+     */
+    static void report(std::ostream& output);
+
+private:
+    static inline bool _enabled = false;
+};
+
+#endif // _STATS_H_
@@ -0,0 +1,189 @@
+#include "stream.h"
+#include "dispatch.h"
+
+#include <cerrno>
+#include <stdexcept>
+#include <fcntl.h>  // open, posix_fadvise
+#include <unistd.h> // read, close
+
+using namespace std;
+
+BlockReader::BlockReader(const string& fileName, size_t blockInts, size_t bufferCount) : _blockInts{blockInts}, _buffers(bufferCount)
+{
+    if (blockInts == 0 || bufferCount < 2) // with a single buffer the reading could not overlap with the processing
+    {
+        throw invalid_argument("Block reader needs a non-zero block size and at least 2 buffers");
+    }
+    for (Buffer &buffer : _buffers)
+    {
+        buffer.data.reset(AlignedAllocator<int>{}.allocate(blockInts));
+    }
+
+    _fileDescriptor = open(fileName.c_str(), O_RDONLY);
+    if (_fileDescriptor < 0)
+    {
+        throw runtime_error("Could not open input file '" + fileName + "'");
+    }
+    posix_fadvise(_fileDescriptor, 0, 0, POSIX_FADV_SEQUENTIAL); // only a hint, failure can be ignored
+
+    _reader = thread(&BlockReader::readBlocks, this); // started after all the other members are initialized
+}
+
+BlockReader::~BlockReader()
+{
+    {
+        lock_guard lock(_mutex);
+        _stop = true;
+    }
+    _condition.notify_all();
+    _reader.join();
+    close(_fileDescriptor);
+}
+
+span<const int> BlockReader::next()
+{
+    unique_lock lock(_mutex);
+    if (_holding) // release the previous block, the reader thread can refill its buffer
+    {
+        _released++;
+        _holding = false;
+        _condition.notify_all();
+    }
+
+    _condition.wait(lock, [this] { return _filled > _released || _endOfFile || _error; });
+    if (_filled > _released) // blocks read before an error or the end of the file are still returned
+    {
+        _holding = true;
+        const Buffer &buffer = _buffers[_released % _buffers.size()];
+        return { buffer.data.get(), buffer.size };
+    }
+    if (_error)
+    {
+        rethrow_exception(_error);
+    }
+    return {};
+}
+
+void BlockReader::readBlocks()
+{
+    try
+    {
+        for (bool endOfFile = false; !endOfFile; )
+        {
+            Buffer *buffer;
+            {
+                // wait for a free buffer, i.e. the consumer released the block previously read into it
+                unique_lock lock(_mutex);
+                _condition.wait(lock, [this] { return _filled - _released < _buffers.size() || _stop; });
+                if (_stop)
+                {
+                    return;
+                }
+                buffer = &_buffers[_filled % _buffers.size()];
+            }
+
+            // read without holding the lock, the consumer meanwhile processes another buffer
+            char *destination = reinterpret_cast<char *>(buffer->data.get());
+            size_t blockBytes = _blockInts * sizeof(int);
+            size_t readBytes = 0;
+            while (readBytes < blockBytes)
+            {
+                ssize_t count = read(_fileDescriptor, destination + readBytes, blockBytes - readBytes); // may read less than requested
+                if (count < 0 && errno == EINTR) // interrupted by a signal before reading anything
+                {
+                    continue;
+                }
+                if (count < 0)
+                {
+                    throw runtime_error("Could not read input file");
+                }
+                if (count == 0)
+                {
+                    endOfFile = true;
+                    break;
+                }
+                readBytes += static_cast<size_t>(count);
+            }
+            buffer->size = (readBytes + sizeof(int) - 1) / sizeof(int);
+            for (size_t i = readBytes; i < buffer->size * sizeof(int); i++) // pad the trailing incomplete integer
+            {
+                destination[i] = 0;
+            }
+
+            lock_guard lock(_mutex);
+            _filled += buffer->size > 0;
+            _endOfFile = endOfFile;
+            _condition.notify_all();
+        }
+    }
+    catch (...)
+    {
+        lock_guard lock(_mutex);
+        _error = current_exception();
+        _condition.notify_all();
+    }
+}
+
+void ScanState::updateClosestToZero(span<const int> block)
+{
+    if (block.empty())
+    {
+        return;
+    }
+
+    int blockClosest = activeKernelSet().getClosestToZero(block.data(), block.size());
+    closest = empty || isCloserToZero(blockClosest, closest) ? blockClosest : closest;
+    empty = false;
+}
+
+void ScanState::updateChunks(span<const int> block)
+{
+    if (block.empty())
+    {
+        return;
+    }
+
+    // the block is counted as if it was preceded by a zero, a chunk continuing from the previous block must not be counted twice
+    chunkCount += activeKernelSet().countChunks(block.data(), block.size()) - (inChunk && block.front() != 0);
+    inChunk = block.back() != 0;
+    empty = false;
+}
+
+int getClosestToZeroStreamed(const string& fileName, size_t blockInts)
+{
+    BlockReader reader(fileName, blockInts);
+    ScanState state;
+    for (span<const int> block = reader.next(); !block.empty(); block = reader.next())
+    {
+        state.updateClosestToZero(block);
+    }
+
+    if (state.empty)
+    {
+        throw invalid_argument("Empty file, 'getClosestToZeroStreamed' expects at least one element in the input file");
+    }
+    return state.closest;
+}
+
+size_t countChunksStreamed(const string& fileName, size_t blockInts)
+{
+    BlockReader reader(fileName, blockInts);
+    ScanState state;
+    for (span<const int> block = reader.next(); !block.empty(); block = reader.next())
+    {
+        state.updateChunks(block);
+    }
+    return state.chunkCount;
+}
+
+ScanStatistics scanStatisticsStreamed(const string& fileName, size_t blockInts)
+{
+    BlockReader reader(fileName, blockInts);
+    ScanStatistics statistics;
+    for (span<const int> block = reader.next(); !block.empty(); block = reader.next())
+    {
+        // the statistics of the blocks are merged in the same way as the statistics of the parts processed by threads
+        statistics = mergeStatistics(statistics, activeKernelSet().scanStatistics(block.data(), block.size()));
+    }
+    return statistics;
+}
@@ -0,0 +1,85 @@
+#ifndef _STREAM_H_
+#define _STREAM_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AlignedAllocator.hpp"
+#include "kernels.h"
+
+/**
+ * Reads a binary file of 32-bit integers in fixed-size blocks on a separate thread, so reading overlaps with the processing
+ * of the already read blocks. Only 'bufferCount' blocks are kept in memory, regardless of the file size.
+ * A trailing incomplete integer is padded with zero bytes.
+ */
+class BlockReader
+{
+public:
+    BlockReader(const std::string& fileName, std::size_t blockInts, std::size_t bufferCount = 2);
+    ~BlockReader();
+
+    BlockReader(const BlockReader&) = delete;
+    BlockReader& operator=(const BlockReader&) = delete;
+
+    /**
+     * Returns the next block of the file, the previously returned block is released and must not be accessed anymore.
+     * Returns an empty block at the end of the file, rethrows errors of the reader thread.
+     */
+    std::span<const int> next();
+
+private:
+    struct Buffer
+    {
+        std::unique_ptr<int[], AlignedAllocator<int>::Deleter> data;
+        std::size_t size = 0; // number of valid integers
+    };
+
+    int _fileDescriptor = -1;
+    std::size_t _blockInts;
+    std::vector<Buffer> _buffers;   // ring of buffers, block 'i' is read into buffer 'i % _buffers.size()'
+
+    std::mutex _mutex;              // guards all the members below
+    std::condition_variable _condition;
+    std::size_t _filled = 0;        // number of blocks read by the reader thread
+    std::size_t _released = 0;      // number of blocks released by the consumer
+    bool _holding = false;          // the consumer holds the block '_released'
+    bool _endOfFile = false;
+    bool _stop = false;
+    std::exception_ptr _error;
+
+    std::thread _reader;
+
+    void readBlocks();
+};
+
+/**
+ * State of the closest to zero search and of the chunk counting carried over between consecutive blocks of the same array.
+ * Processing the blocks one by one gives the same results as processing the whole array at once.
+ */
+struct ScanState
+{
+    bool empty = true;          // no element was processed yet, 'closest' and 'inChunk' are not valid
+    int closest = 0;
+    std::size_t chunkCount = 0;
+    bool inChunk = false;       // the last processed element was non-zero
+
+    void updateClosestToZero(std::span<const int> block);
+    void updateChunks(std::span<const int> block);
+};
+
+/**
+ * Out-of-core variants of 'getClosestToZero', 'countChunks' and of the single-pass statistics,
+ * the file is processed block by block as it is being read.
+ */
+int getClosestToZeroStreamed(const std::string& fileName, std::size_t blockInts);
+std::size_t countChunksStreamed(const std::string& fileName, std::size_t blockInts);
+ScanStatistics scanStatisticsStreamed(const std::string& fileName, std::size_t blockInts);
+
+#endif // _STREAM_H_
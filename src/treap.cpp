@@ -0,0 +1,203 @@
+#include "treap.h"
+
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+using namespace std;
+
+ReversalTreap::ReversalTreap(span<const int> values)
+{
+    if (values.size() >= numeric_limits<uint32_t>::max())
+    {
+        throw length_error("Too many elements of a reversal treap");
+    }
+
+    mt19937 random(values.size()); // deterministic, the same input always gives the same tree
+    _nodes.resize(values.size() + 1);
+    _nodes[0].size = 0; // the empty tree, the minimum and maximum are never read
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        _nodes[i + 1].value = values[i];
+        _nodes[i + 1].priority = random();
+    }
+
+    // Cartesian tree construction, the right spine of the tree is kept on a stack and each new element is appended to it.
+    // Nodes leaving the spine are already complete, so their aggregates are computed right away, the rest at the end.
+    vector<uint32_t> spine;
+    for (uint32_t node = 1; node < _nodes.size(); node++)
+    {
+        uint32_t last = 0;
+        while (!spine.empty() && _nodes[spine.back()].priority < _nodes[node].priority)
+        {
+            last = spine.back();
+            spine.pop_back();
+            update(last);
+        }
+        _nodes[node].left = last;
+        if (!spine.empty())
+        {
+            _nodes[spine.back()].right = node;
+        }
+        spine.push_back(node);
+    }
+    _root = spine.empty() ? 0 : spine.front();
+    for (auto it = spine.rbegin(); it != spine.rend(); it++)
+    {
+        update(*it);
+    }
+}
+
+size_t ReversalTreap::size() const
+{
+    return _nodes[_root].size;
+}
+
+void ReversalTreap::reverse(size_t count)
+{
+    if (count > size())
+    {
+        throw out_of_range("Reversal of " + to_string(count) + " elements of a sequence of " + to_string(size()) + " elements");
+    }
+    if (count < 2)
+    {
+        return;
+    }
+    if (count == size())
+    {
+        applyReverse(_root); // nothing to split
+        return;
+    }
+    auto [prefix, rest] = split(_root, count);
+    applyReverse(prefix);
+    _root = merge(prefix, rest);
+}
+
+size_t ReversalTreap::popMaximum()
+{
+    // The sequence L M R becomes M L' R and then R' L M after the two reversals, i.e. the result is just the reversed R followed by L,
+    // so the tree is split around the maximum and merged again instead of splitting it for each reversal.
+    auto [left, right] = splitMaximum(_root);
+    size_t position = _nodes[left].size;
+    applyReverse(right);
+    _root = merge(right, left);
+    return position;
+}
+
+bool ReversalTreap::ascending() const
+{
+    return _nodes[_root].ascending;
+}
+
+bool ReversalTreap::descending() const
+{
+    return _nodes[_root].descending;
+}
+
+void ReversalTreap::applyReverse(uint32_t node)
+{
+    if (node != 0)
+    {
+        _nodes[node].reversed = !_nodes[node].reversed;
+        swap(_nodes[node].ascending, _nodes[node].descending);
+    }
+}
+
+void ReversalTreap::push(uint32_t node)
+{
+    Node& current = _nodes[node];
+    if (current.reversed)
+    {
+        swap(current.left, current.right);
+        applyReverse(current.left);
+        applyReverse(current.right);
+        current.reversed = false;
+    }
+}
+
+void ReversalTreap::update(uint32_t node)
+{
+    Node& current = _nodes[node];
+    const Node& left = _nodes[current.left];
+    const Node& right = _nodes[current.right];
+    current.size = left.size + 1 + right.size;
+    current.minimum = current.value;
+    current.maximum = current.value;
+    current.ascending = left.ascending && right.ascending;
+    current.descending = left.descending && right.descending;
+    if (current.left != 0)
+    {
+        current.minimum = min(current.minimum, left.minimum);
+        current.maximum = max(current.maximum, left.maximum);
+        current.ascending = current.ascending && left.maximum <= current.value;
+        current.descending = current.descending && left.minimum >= current.value;
+    }
+    if (current.right != 0)
+    {
+        current.minimum = min(current.minimum, right.minimum);
+        current.maximum = max(current.maximum, right.maximum);
+        current.ascending = current.ascending && current.value <= right.minimum;
+        current.descending = current.descending && current.value >= right.maximum;
+    }
+}
+
+pair<uint32_t, uint32_t> ReversalTreap::splitMaximum(uint32_t node)
+{
+    push(node);
+    Node& current = _nodes[node];
+    if (current.right != 0 && _nodes[current.right].maximum == current.maximum) // the last maximum is preferred, it may be at the end already
+    {
+        auto [left, right] = splitMaximum(current.right);
+        current.right = left;
+        update(node);
+        return { node, right };
+    }
+    if (current.value == current.maximum)
+    {
+        return { current.left, current.right };
+    }
+    auto [left, right] = splitMaximum(current.left);
+    current.left = right;
+    update(node);
+    return { left, node };
+}
+
+pair<uint32_t, uint32_t> ReversalTreap::split(uint32_t node, size_t count)
+{
+    if (node == 0)
+    {
+        return { 0, 0 };
+    }
+    push(node);
+    Node& current = _nodes[node];
+    if (_nodes[current.left].size >= count)
+    {
+        auto [prefix, rest] = split(current.left, count);
+        current.left = rest;
+        update(node);
+        return { prefix, node };
+    }
+    auto [prefix, rest] = split(current.right, count - _nodes[current.left].size - 1);
+    current.right = prefix;
+    update(node);
+    return { node, rest };
+}
+
+uint32_t ReversalTreap::merge(uint32_t left, uint32_t right)
+{
+    if (left == 0 || right == 0)
+    {
+        return left != 0 ? left : right;
+    }
+    if (_nodes[left].priority > _nodes[right].priority)
+    {
+        push(left);
+        _nodes[left].right = merge(_nodes[left].right, right);
+        update(left);
+        return left;
+    }
+    push(right);
+    _nodes[right].left = merge(left, _nodes[right].left);
+    update(right);
+    return right;
+}
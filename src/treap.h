@@ -0,0 +1,67 @@
+#ifndef _TREAP_H_
+#define _TREAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+/**
+ * Sequence of integers supporting reversals of its prefixes in O(log n) expected time, i.e. the pancake flips
+ * of 'getReversalsToSort', without moving the elements.
+ *
+ * The sequence is an implicit treap, a randomized balanced binary tree ordered by the positions of the elements,
+ * whose nodes store the sizes of their subtrees instead of keys. A prefix is reversed by splitting it off the tree,
+ * marking its root as reversed and merging it back, the mark is pushed down to the children only when a node is visited.
+ * The nodes are stored in a single array and linked by their indices, the index 0 is the empty tree.
+ * Each subtree also knows its minimum, maximum and whether it is sorted, so these queries do not visit the elements.
+ */
+class ReversalTreap
+{
+public:
+    ReversalTreap(std::span<const int> values); // built in O(n)
+
+    std::size_t size() const;
+
+    /**
+     * Reverses the order of the first 'count' elements, throws 'out_of_range' when there are less elements.
+     */
+    void reverse(std::size_t count);
+
+    /**
+     * Moves the last of the maximal elements to the end by reversing the prefix ending with it and then the whole sequence,
+     * and removes it. Returns its position before the reversals, the sequence must not be empty.
+     */
+    std::size_t popMaximum();
+
+    bool ascending() const;  // non-decreasing, an empty sequence is sorted in both orders
+    bool descending() const; // non-increasing
+
+private:
+    struct Node
+    {
+        int value;
+        int minimum;              // of the subtree
+        int maximum;
+        std::uint32_t priority;   // heap order of the randomized tree, a parent has a higher priority than its children
+        std::uint32_t left = 0;
+        std::uint32_t right = 0;
+        std::uint32_t size = 1;   // of the subtree
+        bool reversed = false;    // the children are yet to be swapped and reversed, the aggregates are already valid
+        bool ascending = true;    // the subtree is sorted in its current order
+        bool descending = true;
+    };
+
+    std::vector<Node> _nodes;
+    std::uint32_t _root = 0;
+
+    void applyReverse(std::uint32_t node);
+    void push(std::uint32_t node);   // passes the reversal mark to the children
+    void update(std::uint32_t node); // recomputes the aggregates from the children
+    std::pair<std::uint32_t, std::uint32_t> splitMaximum(std::uint32_t node); // the elements before and after the last maximum
+    std::pair<std::uint32_t, std::uint32_t> split(std::uint32_t node, std::size_t count); // the first 'count' elements and the rest
+    std::uint32_t merge(std::uint32_t left, std::uint32_t right);
+};
+
+#endif // _TREAP_H_
@@ -1,34 +1,280 @@
 #include "trie.h"
 
+#include <omp.h>
+#include <unistd.h> // STDOUT_FILENO
+
 using namespace std;
 
+static_assert(sizeof(vector<unique_ptr<Trie>, NodeArena::Allocator<unique_ptr<Trie>>>) == sizeof(vector<unique_ptr<INode>>),
+              "The children must have the layout of 'std::vector<std::unique_ptr<INode>>'");
+
 Trie::Trie() : _value{0}, _endOfWord{false}, _children(ALPHABET_SIZE) { }
 
-Trie::Trie(string fileName) : _value{0}, _children(ALPHABET_SIZE) 
+Trie::Trie(string fileName) : _value{0}, _endOfWord{false}, _children(ALPHABET_SIZE) 
 {
-    ifstream file(fileName);
+    ifstream file(fileName, ios::binary);
     if (!file.is_open())
     {
         throw runtime_error("Could not open file '" + fileName + "'.");
     }
 
-    string line;
-    while (getline(file, line))
+    // the whole file is read at once and split into lines in place, the words only refer to it
+    file.seekg(0, ios::end);
+    string content(static_cast<size_t>(file.tellg()), '\0');
+    file.seekg(0, ios::beg);
+    file.read(content.data(), content.size());
+
+    vector<string_view> words;
+    size_t begin = 0;
+    while (begin < content.size())
+    {
+        size_t end = content.find('\n', begin);
+        end = end == string::npos ? content.size() : end;
+        if (end > begin) // skip empty lines
+        {
+            words.emplace_back(content.data() + begin, end - begin);
+        }
+        begin = end + 1;
+    }
+    build(words);
+}
+
+Trie::~Trie()
+{
+    if (_root != nullptr)
+    {
+        // All the nodes below the root, including their children vectors, are in the arenas, which free whole blocks.
+        // The nodes own nothing else, so they do not have to be destroyed one by one, which would also recurse as deep as the longest word.
+        for (auto &child : _children)
+        {
+            [[maybe_unused]] Trie *released = child.release();
+        }
+        // freed explicitly before the arenas, so the order of the members does not matter
+        decltype(_children)().swap(_children);
+        _root.reset();
+    }
+}
+
+void Trie::build(const vector<string_view>& words)
+{
+    // The words are partitioned by their first two characters, the subtrees of different partitions are disjoint.
+    // The first two levels, i.e. the shared spine, are built sequentially, then the subtrees are built in parallel
+    // without any locking, each partition is inserted by a single thread.
+    constexpr size_t PREFIX_LENGTH = 2;
+    constexpr size_t PARTITION_COUNT = ALPHABET_SIZE * ALPHABET_SIZE;
+    auto partition = [](string_view word) -> size_t
+    {
+        return static_cast<unsigned char>(word[0]) * ALPHABET_SIZE + static_cast<unsigned char>(word[1]);
+    };
+
+    _root = make_unique<Root>();
+    _root->arenas = vector<NodeArena>(omp_get_max_threads());
+    _root->totals.add(0, _value);
+    NodeArena::Scope scope(_root->arenas[0]); // the spine is built by this thread
+
+    // counting sort of the longer words by their partitions, the shorter words are inserted right away
+    vector<size_t> partitionStart(PARTITION_COUNT + 1, 0);
+    for (string_view word : words)
+    {
+        if (word.size() <= PREFIX_LENGTH)
+        {
+            insert(word, 0, _root->totals);
+        }
+        else
+        {
+            partitionStart[partition(word) + 1]++;
+        }
+    }
+    vector<Trie *> subtrees; // the node of each non-empty partition at the level 'PREFIX_LENGTH'
+    vector<size_t> subtreePartitions;
+    for (size_t i = 0; i < PARTITION_COUNT; i++)
+    {
+        if (partitionStart[i + 1] > 0)
+        {
+            char prefix[PREFIX_LENGTH] = { static_cast<char>(i / ALPHABET_SIZE), static_cast<char>(i % ALPHABET_SIZE) };
+            subtrees.push_back(insert(string_view(prefix, PREFIX_LENGTH), 0, _root->totals, false));
+            subtreePartitions.push_back(i);
+        }
+        partitionStart[i + 1] += partitionStart[i];
+    }
+    vector<string_view> sortedWords(partitionStart.back());
+    vector<size_t> position(partitionStart.begin(), partitionStart.end() - 1);
+    for (string_view word : words)
+    {
+        if (word.size() > PREFIX_LENGTH)
+        {
+            sortedWords[position[partition(word)]++] = word.substr(PREFIX_LENGTH);
+        }
+    }
+
+    // the partitions are of very different sizes (e.g. 'th' vs 'zx'), hence the dynamic scheduling
+    #pragma omp parallel
     {
-        if (!line.empty())
+        NodeArena::Scope threadScope(_root->arenas[omp_get_thread_num()]); // each thread allocates from its own arena without locking
+        LevelTotals threadTotals;
+
+        #pragma omp for schedule(dynamic) nowait
+        for (size_t i = 0; i < subtrees.size(); i++)
         {
-            Trie* current = this;
-            for (char c : line)
+            size_t partitionIdx = subtreePartitions[i];
+            for (size_t j = partitionStart[partitionIdx]; j < partitionStart[partitionIdx + 1]; j++)
             {
-                if (current->_children[c] == nullptr)
-                {
-                    current->_children[c] = make_unique<Trie>();
-                }
-                current = current->_children[c].get();
-                current->_value = static_cast<int>(c);
+                subtrees[i]->insert(sortedWords[j], PREFIX_LENGTH, threadTotals);
             }
-            current->_endOfWord = true;
         }
+
+        #pragma omp critical
+        _root->totals.merge(threadTotals);
+    }
+}
+
+Trie* Trie::insert(string_view word, size_t level, LevelTotals& totals, bool endOfWord)
+{
+    Trie* current = this;
+    for (char c : word)
+    {
+        unsigned char index = static_cast<unsigned char>(c); // characters above 127 are negative, they cannot index the children directly
+        level++;
+        if (current->_children[index] == nullptr)
+        {
+            current->_children[index].reset(new Trie());
+            current->_childCount++;
+            current->_children[index]->_value = static_cast<int>(c);
+            totals.add(level, static_cast<int>(c));
+        }
+        current = current->_children[index].get();
+    }
+    current->_endOfWord = current->_endOfWord || endOfWord;
+    return current;
+}
+
+Trie::Root& Trie::root()
+{
+    if (_root == nullptr)
+    {
+        _root = make_unique<Root>();
+        _root->arenas = vector<NodeArena>(1);
+        _root->totals.add(0, _value);
+    }
+    return *_root;
+}
+
+bool Trie::insert(const string& word)
+{
+    if (word.empty())
+    {
+        return false;
+    }
+    Root& data = root();
+    NodeArena::Scope scope(data.arenas[0]); // also reuses the nodes of the erased words
+
+    Trie* last = insert(word, 0, data.totals, false);
+    if (last->_endOfWord)
+    {
+        return false;
+    }
+    last->_endOfWord = true;
+    return true;
+}
+
+bool Trie::erase(const string& word)
+{
+    vector<Trie *> path{ this }; // nodes of the word, starting with the root
+    for (char c : word)
+    {
+        Trie* child = path.back()->_children[static_cast<unsigned char>(c)].get();
+        if (child == nullptr)
+        {
+            return false;
+        }
+        path.push_back(child);
+    }
+    if (word.empty() || !path.back()->_endOfWord)
+    {
+        return false;
+    }
+    path.back()->_endOfWord = false;
+
+    // remove the nodes of the word from the deepest one, until reaching a node, which is a part of another word
+    for (size_t level = word.size(); level > 0 && path[level]->_childCount == 0 && !path[level]->_endOfWord; level--)
+    {
+        _root->totals.remove(level, path[level]->_value); // the root data exist, since the tree is not empty
+        path[level - 1]->_children[static_cast<unsigned char>(word[level - 1])].reset();
+        path[level - 1]->_childCount--;
+    }
+    return true;
+}
+
+bool Trie::contains(const string& word) const
+{
+    const Trie* current = this;
+    for (char c : word)
+    {
+        current = current->_children[static_cast<unsigned char>(c)].get();
+        if (current == nullptr)
+        {
+            return false;
+        }
+    }
+    return !word.empty() && current->_endOfWord;
+}
+
+int64_t Trie::levelSum(size_t n) const
+{
+    if (_root == nullptr)
+    {
+        return n == 0 ? _value : 0; // nothing was inserted yet
+    }
+    return n < _root->totals.sums.size() ? _root->totals.sums[n] : 0;
+}
+
+size_t Trie::levelNodeCount(size_t n) const
+{
+    if (_root == nullptr)
+    {
+        return n == 0 ? 1 : 0;
+    }
+    return n < _root->totals.counts.size() ? _root->totals.counts[n] : 0;
+}
+
+size_t Trie::levelCount() const
+{
+    return _root == nullptr ? 1 : _root->totals.counts.size();
+}
+
+void Trie::LevelTotals::add(size_t level, int value)
+{
+    if (level >= counts.size())
+    {
+        sums.resize(level + 1, 0);
+        counts.resize(level + 1, 0);
+    }
+    sums[level] += value;
+    counts[level]++;
+}
+
+void Trie::LevelTotals::remove(size_t level, int value)
+{
+    sums[level] -= value;
+    counts[level]--;
+    while (!counts.empty() && counts.back() == 0) // the deepest levels may become empty
+    {
+        sums.pop_back();
+        counts.pop_back();
+    }
+}
+
+void Trie::LevelTotals::merge(const LevelTotals& other)
+{
+    if (other.counts.size() > counts.size())
+    {
+        sums.resize(other.counts.size(), 0);
+        counts.resize(other.counts.size(), 0);
+    }
+    for (size_t level = 0; level < other.counts.size(); level++)
+    {
+        sums[level] += other.sums[level];
+        counts[level] += other.counts[level];
     }
 }
 
@@ -39,42 +285,68 @@ int Trie::value() const
 
 const vector<unique_ptr<INode>>& Trie::children() const
 {
-    return reinterpret_cast<const std::vector<std::unique_ptr<INode>> &>(_children);
+    // the children vector differs only in its stateless allocator, see the assertion above
+    const void *children = &_children;
+    return *static_cast<const std::vector<std::unique_ptr<INode>> *>(children);
 }
 
 void Trie::print()
 {
-    string currentWord = "";
-    print(currentWord);
+    cout.flush(); // the words are written directly to the file descriptor, after anything printed before
+    WordWriter writer(STDOUT_FILENO);
+    exportWords(writer);
+    writer.finish();
 }
 
 void Trie::printASCII()
 {
-    string currentWord = "";
-    print(currentWord, [](const string& word) 
-    { 
-        for (char c : word)
-        {
-            cout << setw(4) << setfill(' ') << static_cast<int>(c);
-        }
-        cout << endl;
-    });
+    cout.flush();
+    WordWriter writer(STDOUT_FILENO, WordWriter::Format::ASCII);
+    exportWords(writer);
+    writer.finish();
 }
 
-void Trie::print(string currentWord, const function<void(const string&)>& displayFunction)
+void Trie::exportWords(WordWriter& writer) const
 {
+    // iterative depth-first traversal with an explicit stack, the current word is extended and shortened in place
+    struct Frame
+    {
+        const Trie *node;
+        int nextChild;        // the next child to visit
+        int remainingChildren; // the rest of the children slots is not scanned, when all the children were visited
+    };
+    vector<Frame> stack{ { this, 0, _childCount } };
+    string currentWord;
     if (_endOfWord)
     {
-        displayFunction(currentWord);
+        writer.writeWord(currentWord);
     }
 
-    for (int i = 0; i < ALPHABET_SIZE; i++)
+    while (!stack.empty())
     {
-        if (_children[i] != nullptr)
+        Frame &frame = stack.back();
+        if (frame.remainingChildren == 0) // all the children visited
+        {
+            stack.pop_back();
+            if (!currentWord.empty())
+            {
+                currentWord.pop_back();
+            }
+            continue;
+        }
+
+        while (frame.node->_children[frame.nextChild] == nullptr)
+        {
+            frame.nextChild++;
+        }
+        const Trie *child = frame.node->_children[frame.nextChild].get();
+        currentWord.push_back(static_cast<char>(frame.nextChild));
+        frame.nextChild++;
+        frame.remainingChildren--;
+        if (child->_endOfWord)
         {
-            currentWord.push_back(static_cast<char>(i));
-            _children[i]->print(currentWord, displayFunction);
-            currentWord.pop_back();
+            writer.writeWord(currentWord);
         }
+        stack.push_back({ child, 0, child->_childCount }); // invalidates 'frame'
     }
 }
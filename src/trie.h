@@ -1,14 +1,18 @@
 #ifndef _TRIE_H_ // use guards instead of #pragma once, which is non-standard and older compilers may not support it
 #define _TRIE_H_
 
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <fstream>
 #include <iostream>
 #include <functional>
 #include <iomanip>
+#include <string_view>
 
 #include "INode.h"
+#include "arena.h"
+#include "export.h"
 
 class Trie : public INode
 {
@@ -16,20 +20,64 @@ public:
     constexpr static int ALPHABET_SIZE = 256;
 
     Trie();
-    Trie(std::string fileName);
+    Trie(std::string fileName); // the words are inserted in parallel, see 'build'
+    ~Trie() override;
+
+    // the nodes are allocated from the arenas of the root when building from a file, otherwise from the heap
+    static void* operator new(std::size_t size) { return NodeArena::allocate(size); }
+    static void operator delete(void* p) { NodeArena::deallocate(p); }
 
     int value() const override;
     const std::vector<std::unique_ptr<INode>>& children() const override;
 
-    void print();
-    void printASCII();
+    // Online updates of the dictionary, the sums and counts of the nodes of each level are updated as the nodes are
+    // added or removed, so the level queries below take a constant time without any traversal.
+    bool insert(const std::string& word); // returns false, when the word is already present or empty
+    bool erase(const std::string& word);  // returns false, when the word is not present, removes the nodes of no other word
+    bool contains(const std::string& word) const;
+
+    std::int64_t levelSum(std::size_t n) const; // the same as 'getLevelSum(*this, n)', but with a 64-bit result
+    std::size_t levelNodeCount(std::size_t n) const;
+    std::size_t levelCount() const;             // number of non-empty levels, including the root
+
+    void print();      // writes the words to the standard output, one per line
+    void printASCII(); // writes the character codes of the words to the standard output
+    void exportWords(WordWriter& writer) const; // writes the words in the order of their characters
 
 private:
+    /**
+     * Sums of the values and numbers of the nodes of each level.
+     */
+    struct LevelTotals
+    {
+        std::vector<std::int64_t> sums;
+        std::vector<std::size_t> counts;
+
+        void add(std::size_t level, int value);
+        void remove(std::size_t level, int value);
+        void merge(const LevelTotals& other);
+    };
+
+    /**
+     * Data of the whole tree, which only the root has.
+     */
+    struct Root
+    {
+        std::vector<NodeArena> arenas; // arenas of all the nodes, one per thread building the tree, updates use the first one
+        LevelTotals totals;
+    };
+
     int _value;
     bool _endOfWord;
-    std::vector<std::unique_ptr<Trie>> _children;
+    std::uint16_t _childCount = 0; // fits into the padding after '_endOfWord'
+    // 'children' reinterprets the vector as 'std::vector<std::unique_ptr<INode>>', the stateless allocator keeps the same layout
+    std::vector<std::unique_ptr<Trie>, NodeArena::Allocator<std::unique_ptr<Trie>>> _children;
+    std::unique_ptr<Root> _root; // owns the arenas of the nodes below, '~Trie' releases and frees the children before it
 
-    void print(std::string currentWord, const std::function<void(const std::string&)>& displayFunction = [](const std::string& word) { std::cout << word << std::endl; });
+    void build(const std::vector<std::string_view>& words);
+    Root& root(); // creates the data of the root on the first update
+    // inserts the word below this node at the 'level', returns the last node of the word, the added nodes are added to the 'totals'
+    Trie* insert(std::string_view word, std::size_t level, LevelTotals& totals, bool endOfWord = true);
 };
 
 
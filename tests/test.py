@@ -1,7 +1,11 @@
 import re
 from glob import glob
+import json
+import math
 import os
+import random
 import numpy as np
+import subprocess
 
 RED = "\033[1;31m"
 GREEN = "\033[1;32m"
@@ -14,24 +18,31 @@ BLACK = "\033[1;30m"
 TEST_FILES_DIR = "test_files"
 RESULT_FILES_DIR = "result_files"
 
+# (make target, additional program arguments), the default build is tested with each kernel pinned, unsupported kernels fail to run
+APPROACHES = [("a1", ""), ("a2", ""), ("a3", ""),
+              ("all", "--kernel scalar"), ("all", "--kernel sse4.1"), ("all", "--kernel avx2"), ("all", "--kernel avx512bw"),
+              ("all", "--load read"), ("all", "--populate --huge-pages"), ("all", "--stats"),
+              ("all", "--numa first-touch --bind scatter"), ("all", "--numa interleave --bind compact")]
+# the streaming mode supports only the assignments 1 and 2, small blocks test the state carried over between blocks
+# the compact trie is an alternative representation of the trie of the assignment 3
+TRIE_APPROACHES = [("all", "--compact-trie"), ("a1", "--per-level"), ("a2", "--per-level"), ("a3", "--per-level"), ("all", "--per-level")]
+STREAMING_APPROACHES = [("all", "--stream --block-size 3"), ("all", "--stream --block-size 1000")]
+
 def test_assignment(number : int):
     print(f"{CYAN}Testing assignment {number}{BLACK}")
 
-    for approach in ["a1", "a2", "a3"]:
-        print(f"  {MAGENTA}Testing approach {approach}{BLACK}")
+    for approach, arguments in APPROACHES + STREAMING_APPROACHES:
+        print(f"  {MAGENTA}Testing approach {approach} {arguments}{BLACK}")
         os.system(f"rm -rf {RESULT_FILES_DIR}")
         os.system(f"make {approach} 2> /dev/null > /dev/null")
         os.makedirs(RESULT_FILES_DIR, exist_ok=True)
 
         for filename in sorted(glob(f"{TEST_FILES_DIR}/t{number}_*.bin")):
-            if approach == "a3" and os.stat(filename).st_size < 2**10: # skip files smaller than 1024 bytes for the third approach
-                continue
-
             result = re.search(r"t" + str(number) + r"_.*?(-?\d+)\.bin", filename).group(1)
             file_base = os.path.basename(filename).replace(".bin", "")
             output_filename = file_base + ".txt"
             
-            os.system(f"file={file_base}; ./main -t {number} -i {TEST_FILES_DIR}/$file.bin -o {RESULT_FILES_DIR}/$file.txt 2>/dev/null")
+            os.system(f"file={file_base}; ./main -t {number} -i {TEST_FILES_DIR}/$file.bin -o {RESULT_FILES_DIR}/$file.txt {arguments} 2>/dev/null")
             try:
                 with open(f"{RESULT_FILES_DIR}/{output_filename}", "r") as f:
                     output = f.read().strip()
@@ -46,14 +57,14 @@ def test_assignment(number : int):
 def test_assignment_3():
     print(f"{CYAN}Testing assignment 3{BLACK}")
 
-    for approach in ["a1", "a2", "a3"]:
-        print(f"  {MAGENTA}Testing approach {approach}{BLACK}")
+    for approach, arguments in APPROACHES + TRIE_APPROACHES:
+        print(f"  {MAGENTA}Testing approach {approach} {arguments}{BLACK}")
         os.system(f"rm -rf {RESULT_FILES_DIR}")
         os.system(f"make {approach} 2>/dev/null >/dev/null")
         os.makedirs(RESULT_FILES_DIR, exist_ok=True)
 
-        os.system(f"file=t3_1; ./main -t 3 -i {TEST_FILES_DIR}/$file.txt -o {RESULT_FILES_DIR}/$file.txt 2>/dev/null >/dev/null")
-        os.system(f"file=t3_2; ./main -t 3 -i {TEST_FILES_DIR}/$file.txt -o {RESULT_FILES_DIR}/$file.txt 2>/dev/null >/dev/null")
+        os.system(f"file=t3_1; ./main -t 3 -i {TEST_FILES_DIR}/$file.txt -o {RESULT_FILES_DIR}/$file.txt {arguments} 2>/dev/null >/dev/null")
+        os.system(f"file=t3_2; ./main -t 3 -i {TEST_FILES_DIR}/$file.txt -o {RESULT_FILES_DIR}/$file.txt {arguments} 2>/dev/null >/dev/null")
 
         filename = "t3_1.txt"
         try:
@@ -81,6 +92,291 @@ def test_assignment_3():
         else:
             print(f"    {RED}{filename} failed.{BLACK} Expected: {result}, got: {output}")
 
+def test_level_sums():
+    print(f"{CYAN}Testing parallel level sums{BLACK}")
+    os.system(f"rm -rf {RESULT_FILES_DIR}")
+    os.makedirs(RESULT_FILES_DIR, exist_ok=True)
+    os.system(f"make 2>/dev/null >/dev/null")
+    generator = random.Random(14)
+
+    # the words of the narrow trie share a prefix, so there is a single subtree at the depth of the tasks and more than one
+    # thread takes the level by level frontier, the wide trie has hundreds of such subtrees and takes the tasks
+    letters = "abcdefghijklmnopqrstuvwxyz"
+    words = {"narrow": ["zz" + "".join(generator.choice(letters[:8]) for _ in range(generator.randint(1, 12))) for _ in range(20000)],
+             "wide": ["".join(generator.choice(letters) for _ in range(generator.randint(1, 12))) for _ in range(20000)]}
+    for name, lines in words.items():
+        with open(f"{RESULT_FILES_DIR}/{name}.txt", "w") as f:
+            f.write("\n".join(lines) + "\n")
+    filenames = [f"{RESULT_FILES_DIR}/narrow.txt", f"{RESULT_FILES_DIR}/wide.txt", f"{TEST_FILES_DIR}/t3_1.txt"]
+
+    for filename in filenames:
+        # the scalar kernels traverse the trie sequentially depth-first, the vector kernel sets select the parallel traversal
+        os.system(f"OMP_NUM_THREADS=1 ./main -t 3 -i {filename} -o {RESULT_FILES_DIR}/reference.txt --per-level --kernel scalar 2>/dev/null >/dev/null")
+        with open(f"{RESULT_FILES_DIR}/reference.txt", "r") as f:
+            result = f.read().strip()
+
+        for threads in [1, 2, 4, 8]:
+            os.system(f"OMP_NUM_THREADS={threads} ./main -t 3 -i {filename} -o {RESULT_FILES_DIR}/level_sums.txt --per-level --kernel sse4.1 2>/dev/null >/dev/null")
+            try:
+                with open(f"{RESULT_FILES_DIR}/level_sums.txt", "r") as f:
+                    output = f.read().strip()
+            except:
+                output = "file could not be opened or read."
+
+            if output == result and result != "":
+                print(f"    {GREEN}{filename} with {threads} threads passed.{BLACK}")
+            else:
+                print(f"    {RED}{filename} with {threads} threads failed.{BLACK} Expected: {result}, got: {output}")
+
+def statistics_reference(data):
+    non_zero = np.concatenate(([0], (data != 0).astype(np.int8), [0]))
+    edges = np.diff(non_zero)
+    starts, ends = np.flatnonzero(edges == 1), np.flatnonzero(edges == -1)
+    closest = sorted(data, key=lambda value: (abs(int(value)), -int(value)))[0]
+    return (f"closest {closest}\nchunks {len(starts)}\nmin {data.min()}\nmax {data.max()}\n"
+            f"zeros {np.count_nonzero(data == 0)}\nlongest_chunk {(ends - starts).max(initial=0)}")
+
+def test_statistics():
+    print(f"{CYAN}Testing single-pass statistics{BLACK}")
+    os.system(f"rm -rf {RESULT_FILES_DIR}")
+    os.makedirs(RESULT_FILES_DIR, exist_ok=True)
+    os.system(f"make 2>/dev/null >/dev/null")
+
+    for approach, arguments in APPROACHES + STREAMING_APPROACHES:
+        if approach != "all": # the statistics are computed only by the kernels selected at runtime
+            continue
+        print(f"  {MAGENTA}Testing approach {approach} {arguments}{BLACK}")
+
+        for filename in sorted(glob(f"{TEST_FILES_DIR}/t[12]_*.bin")):
+            result = statistics_reference(np.fromfile(filename, dtype=np.int32))
+            os.system(f"./main -t 5 -i {filename} -o {RESULT_FILES_DIR}/statistics.txt {arguments} 2>/dev/null")
+            try:
+                with open(f"{RESULT_FILES_DIR}/statistics.txt", "r") as f:
+                    output = f.read().strip()
+            except:
+                output = "file could not be opened or read."
+
+            if output == result:
+                print(f"    {GREEN}{filename} passed.{BLACK}")
+            else:
+                print(f"    {RED}{filename} failed.{BLACK} Expected: {result}, got: {output}")
+
+    # the report is the last line of the standard error output, the counters may not be available, e.g. in a virtual machine
+    print(f"  {MAGENTA}Testing the --stats report{BLACK}")
+    for arguments in ["", "--load read", "--stream"]:
+        process = subprocess.run(f"./main -t 5 -i {TEST_FILES_DIR}/t2_8.bin -o {RESULT_FILES_DIR}/statistics.txt --stats {arguments}",
+                                 shell=True, capture_output=True, text=True)
+        try:
+            report = json.loads(process.stderr.strip().splitlines()[-1])
+            phases = [phase["name"] for phase in report["phases"]]
+        except:
+            phases = "report could not be parsed."
+
+        if isinstance(phases, list) and all(name in phases for name in ["open", "compute", "write"]):
+            print(f"    {GREEN}--stats {arguments} passed.{BLACK}")
+        else:
+            print(f"    {RED}--stats {arguments} failed.{BLACK} Expected: open, compute and write phases, got: {phases}")
+
+def closest_reference(data):
+    # the distance followed by the sign, i.e. 0.0 is closer than -0.0, the same as a positive integer is closer than the negative one
+    if data.dtype.kind == "f":
+        return min(data.tolist(), key=lambda value: (abs(value), math.copysign(1, value) < 0))
+    return min(data.tolist(), key=lambda value: (abs(value), value < 0))
+
+def test_dtypes():
+    print(f"{CYAN}Testing element types{BLACK}")
+    os.system(f"rm -rf {RESULT_FILES_DIR}")
+    os.makedirs(RESULT_FILES_DIR, exist_ok=True)
+    os.system(f"make 2>/dev/null >/dev/null")
+    generator = np.random.default_rng(42)
+
+    for dtype, numpy_type in [("int8", np.int8), ("int16", np.int16), ("int64", np.int64), ("float", np.float32)]:
+        for kernel in ["scalar", "sse4.1", "avx2", "avx512bw"]:
+            print(f"  {MAGENTA}Testing element type {dtype} with the kernel {kernel}{BLACK}")
+            # lengths around the vector lengths of all the types and a length split among the threads
+            for size in [1, 7, 63, 64, 65, 100003]:
+                if numpy_type == np.float32:
+                    data = (generator.integers(-100, 100, size) / 4).astype(numpy_type)
+                    data[generator.random(size) < 0.1] = -0.0
+                else:
+                    limits = np.iinfo(numpy_type)
+                    data = generator.integers(limits.min, limits.max, size, dtype=numpy_type, endpoint=True)
+                    data[0] = limits.min
+                data[generator.random(size) < 0.3] = 0
+                data.tofile(f"{RESULT_FILES_DIR}/data.bin")
+
+                nonzero = np.concatenate(([0], (data != 0).astype(np.int8)))
+                for number, result in [(1, closest_reference(data)), (2, int(np.count_nonzero(np.diff(nonzero) == 1)))]:
+                    os.system(f"./main -t {number} -i {RESULT_FILES_DIR}/data.bin -o {RESULT_FILES_DIR}/result.txt --dtype {dtype} --kernel {kernel} 2>/dev/null")
+                    try:
+                        with open(f"{RESULT_FILES_DIR}/result.txt", "r") as f:
+                            output = f.read().strip()
+                    except:
+                        output = "file could not be opened or read."
+
+                    expected = repr(float(result)) if numpy_type == np.float32 and number == 1 else str(result)
+                    parsed = repr(float(output)) if numpy_type == np.float32 and number == 1 and output[:1] in "-0123456789" else output
+                    if parsed == expected:
+                        print(f"    {GREEN}test {number} of {size} elements passed.{BLACK}")
+                    else:
+                        print(f"    {RED}test {number} of {size} elements failed.{BLACK} Expected: {expected}, got: {output}")
+
+def test_nearest():
+    print(f"{CYAN}Testing top-k nearest elements{BLACK}")
+    os.system(f"rm -rf {RESULT_FILES_DIR}")
+    os.makedirs(RESULT_FILES_DIR, exist_ok=True)
+    os.system(f"make 2>/dev/null >/dev/null")
+    generator = np.random.default_rng(42)
+    limits = np.iinfo(np.int32)
+
+    for kernel in ["scalar", "sse4.1", "avx2", "avx512bw"]:
+        print(f"  {MAGENTA}Testing kernel {kernel}{BLACK}")
+        # few distinct values test the ties, the extreme targets test the distances, which do not fit into 'int'
+        for size, low, high, target, k in [(1, -5, 5, 0, 3), (100, -20, 20, 3, 0), (1000, -20, 20, 3, 25), (100003, -1000, 1000, -17, 100),
+                                           (50000, limits.min, limits.max, limits.min, 10), (50000, limits.min, limits.max, limits.max, 10),
+                                           (1000, -20, 20, 3, 100000000000000)]: # 'k' far above the size must not be allocated
+            data = generator.integers(low, high, size, dtype=np.int32, endpoint=True)
+            data.tofile(f"{RESULT_FILES_DIR}/data.bin")
+            # ordered by the distance and then from the larger value
+            order = np.lexsort((-data.astype(np.int64), np.abs(data.astype(np.int64) - target)))
+            result = "\n".join(str(value) for value in data[order[:k]])
+
+            os.system(f"./main -t 6 -i {RESULT_FILES_DIR}/data.bin -o {RESULT_FILES_DIR}/nearest.txt --target {target} --top {k} --kernel {kernel} 2>/dev/null")
+            try:
+                with open(f"{RESULT_FILES_DIR}/nearest.txt", "r") as f:
+                    output = f.read().strip()
+            except:
+                output = "file could not be opened or read."
+
+            if output == result:
+                print(f"    {GREEN}{k} nearest to {target} of {size} elements passed.{BLACK}")
+            else:
+                print(f"    {RED}{k} nearest to {target} of {size} elements failed.{BLACK} Expected: {result}, got: {output}")
+
+def test_ranges():
+    print(f"{CYAN}Testing range queries{BLACK}")
+    os.system(f"rm -rf {RESULT_FILES_DIR}")
+    os.makedirs(RESULT_FILES_DIR, exist_ok=True)
+    os.system(f"make 2>/dev/null >/dev/null")
+    generator = np.random.default_rng(24)
+    block = 1 << 16 # the default block size of the index
+
+    # frequent zeros end the chunks at the block boundaries as well, the appended data make the stored index out of date,
+    # so do the data rewritten in place to the same size and the first block changed with the modification time kept
+    data = generator.integers(-3, 3, 3 * block + 1234, dtype=np.int32, endpoint=True)
+    for change in [0, 5000, "rewritten", "same time"]:
+        if change == "rewritten":
+            data = generator.integers(-3, 3, len(data), dtype=np.int32, endpoint=True)
+        elif change == "same time":
+            data[:10] = 7
+        else:
+            data = np.concatenate((data, generator.integers(-3, 3, change, dtype=np.int32, endpoint=True)))
+        modified = os.stat(f"{RESULT_FILES_DIR}/data.bin") if change == "same time" else None
+        data.tofile(f"{RESULT_FILES_DIR}/data.bin")
+        if modified is not None:
+            os.utime(f"{RESULT_FILES_DIR}/data.bin", ns=(modified.st_atime_ns, modified.st_mtime_ns))
+        for begin, end in [(0, len(data)), (5, 6), (block - 1, block + 1), (block, 3 * block), (17, len(data) - 1), (block + 3, len(data))]:
+            result = statistics_reference(data[begin:end])
+            for arguments in ["", "--index"]:
+                os.system(f"./main -t 5 -i {RESULT_FILES_DIR}/data.bin -o {RESULT_FILES_DIR}/statistics.txt --range {begin} {end} {arguments} 2>/dev/null")
+                try:
+                    with open(f"{RESULT_FILES_DIR}/statistics.txt", "r") as f:
+                        output = f.read().strip()
+                except:
+                    output = "file could not be opened or read."
+
+                if output == result:
+                    print(f"    {GREEN}[{begin}, {end}) of {len(data)} elements {arguments} passed.{BLACK}")
+                else:
+                    print(f"    {RED}[{begin}, {end}) of {len(data)} elements {arguments} failed.{BLACK} Expected: {result}, got: {output}")
+
+    if os.path.exists(f"{RESULT_FILES_DIR}/data.bin.idx"):
+        print(f"    {GREEN}Index stored next to the data passed.{BLACK}")
+    else:
+        print(f"    {RED}Index stored next to the data failed.{BLACK}")
+
+def test_incremental():
+    print(f"{CYAN}Testing incremental mode{BLACK}")
+    os.system(f"rm -rf {RESULT_FILES_DIR}")
+    os.makedirs(RESULT_FILES_DIR, exist_ok=True)
+    os.system(f"make 2>/dev/null >/dev/null")
+    generator = np.random.default_rng(25)
+    filename = f"{RESULT_FILES_DIR}/data.bin"
+
+    # each run must give the results of the whole file, the appends continue the last chunk or start after a zero,
+    # an incomplete integer is left for the next run and a rewritten file is processed again from the beginning
+    data = np.array([], dtype=np.int32)
+    for appended in [1, 10, 0, 1000, 7, 100000, "partial", "rewritten"]:
+        if appended == "partial":
+            with open(filename, "ab") as f:
+                f.write(b"\x07\x00")
+        elif appended == "rewritten":
+            data = generator.integers(-2, 2, 500, dtype=np.int32, endpoint=True)
+            data.tofile(filename)
+        else:
+            elements = generator.integers(-2, 2, appended, dtype=np.int32, endpoint=True)
+            data = np.concatenate((data, elements))
+            with open(filename, "ab") as f:
+                f.write(elements.tobytes())
+
+        for number, result in [(5, statistics_reference(data)), (2, statistics_reference(data).split("\n")[1].split()[1])]:
+            os.system(f"./main -t {number} -i {filename} -o {RESULT_FILES_DIR}/incremental.txt --incremental 2>/dev/null")
+            try:
+                with open(f"{RESULT_FILES_DIR}/incremental.txt", "r") as f:
+                    output = f.read().strip()
+            except:
+                output = "file could not be opened or read."
+
+            if output == result:
+                print(f"    {GREEN}Test {number} after {appended} appended, {len(data)} elements passed.{BLACK}")
+            else:
+                print(f"    {RED}Test {number} after {appended} appended, {len(data)} elements failed.{BLACK} Expected: {result}, got: {output}")
+
+    # the loadings reading the whole file would make an update as expensive as a full run
+    for arguments in ["--load read", "--populate", "--numa first-touch", "--numa interleave"]:
+        process = subprocess.run(f"./main -t 2 -i {filename} -o {RESULT_FILES_DIR}/incremental.txt --incremental {arguments}",
+                                 shell=True, capture_output=True, text=True)
+        if process.returncode != 0 and "Incremental mode cannot be combined" in process.stderr:
+            print(f"    {GREEN}--incremental {arguments} rejected passed.{BLACK}")
+        else:
+            print(f"    {RED}--incremental {arguments} rejected failed.{BLACK} Got: {process.stderr.strip()}")
+
+def test_server():
+    print(f"{CYAN}Testing server mode{BLACK}")
+    os.system(f"make 2>/dev/null >/dev/null")
+
+    # all the requests are pipelined at once, the responses must come in the same order
+    requests, results = [], []
+    for number in (1, 2):
+        for filename in sorted(glob(f"{TEST_FILES_DIR}/t{number}_*.bin")):
+            requests.append(f"{'closest' if number == 1 else 'chunks'} {filename}")
+            results.append("ok " + re.search(r"t" + str(number) + r"_.*?(-?\d+)\.bin", filename).group(1))
+    levels = " ".join(str(level) for level in list(range(12)) + [123])
+    requests += [f"levelsum {TEST_FILES_DIR}/t3_1.txt {levels}", f"levelsum {TEST_FILES_DIR}/t3_2.txt {levels}"]
+    results += ["ok 0 276 413 483 634 541 441 221 206 100 97 0 0", "ok 0 97 97 394 394 394 394 394 394 32 58 68 0"]
+    # the level sums follow the updates of the dictionary, 'z' is 122
+    dictionary = f"{TEST_FILES_DIR}/t3_1.txt"
+    requests += [f"insert {dictionary} zzzz", f"insert {dictionary} zzzz", f"levelsum {dictionary} 0 1 2 3 4",
+                 f"erase {dictionary} zzzz", f"erase {dictionary} zzzz", f"levelsum {dictionary} 0 1 2 3 4"]
+    results += ["ok 1", "ok 0", "ok 0 398 535 605 756", "ok 1", "ok 0", "ok 0 276 413 483 634"]
+    np.array([0, 3, -1, 0, 0, 2, 5, 0], dtype=np.int32).tofile(f"{RESULT_FILES_DIR}/range.bin")
+    requests += [f"nearest {TEST_FILES_DIR}/t1_5.bin 5 1", f"nearest {TEST_FILES_DIR}/t1_5.bin 5 x"]
+    requests += [f"nearest {TEST_FILES_DIR}/t1_5.bin 5 -1", f"nearest {RESULT_FILES_DIR}/range.bin 0 100000000000000"]
+    results += ["ok 5", "error Target and number of elements expected after the file name of 'nearest'"]
+    results += ["error Target and number of elements expected after the file name of 'nearest'", "ok 0 0 0 0 -1 2 3 5"]
+    requests += [f"range {RESULT_FILES_DIR}/range.bin 1 7", f"range {RESULT_FILES_DIR}/range.bin 5 7", f"range {RESULT_FILES_DIR}/range.bin 2 9"]
+    results += ["ok 0 2", "ok 2 1", "error Range [2, 9) is not inside of the 8 integers"]
+    requests += ["closest missing.bin", requests[0]] # an error must not stop the server
+    results += ["error Could not open input file 'missing.bin'", results[0]]
+
+    process = subprocess.run(["./main", "--serve"], input="\n".join(requests) + "\n", capture_output=True, text=True)
+    output = process.stdout.strip().split("\n")
+    for request, result, response in zip(requests, results, output + [""] * len(requests)):
+        if response == result:
+            print(f"    {GREEN}{request} passed.{BLACK}")
+        else:
+            print(f"    {RED}{request} failed.{BLACK} Expected: {result}, got: {response}")
+
 def test_assignment_4():
     print(f"{CYAN}Testing assignment 4{BLACK}")
     os.system(f"rm -rf {RESULT_FILES_DIR}")
@@ -88,29 +384,69 @@ def test_assignment_4():
     os.system(f"make 2>/dev/null >/dev/null")
     filename = "t4_random.bin"
 
-    for i in range(25):
-        n = np.random.randint(1, 100)
-        data = np.random.randint(-1000, 1000, n, dtype=np.int32)
-        data.tofile(os.path.join(TEST_FILES_DIR, filename))
+    for plan in ["insertion", "selection"]:
+        for i in range(25):
+            n = np.random.randint(1, 100)
+            data = np.random.randint(-1000, 1000, n, dtype=np.int32)
+            data.tofile(os.path.join(TEST_FILES_DIR, filename))
 
-        os.system(f"file={filename}; ./main -t 4 -i {TEST_FILES_DIR}/$file -o {RESULT_FILES_DIR}/$file")
-        try:
-            with open(f"{RESULT_FILES_DIR}/{filename}", "rb") as f:
-                output = f.read()
-                commands = np.frombuffer(output, dtype=np.uint64)    
-        except:
-            print(f"    {RED}Test {i} failed.{BLACK}")
+            os.system(f"file={filename}; ./main -t 4 -i {TEST_FILES_DIR}/$file -o {RESULT_FILES_DIR}/$file --reversal-plan {plan}")
+            try:
+                with open(f"{RESULT_FILES_DIR}/{filename}", "rb") as f:
+                    output = f.read()
+                    commands = np.frombuffer(output, dtype=np.uint64)    
+            except:
+                print(f"    {RED}Test {i} ({plan}) failed.{BLACK}")
+                exit(1)
+            
+            for command in commands:
+                data[:command] = np.flip(data[:command])
+            
+            # verify that the array is sorted, the selection plan needs at most 2 reversals per element
+            if np.all(data[:-1] <= data[1:]) and (plan != "selection" or len(commands) <= max(0, 2 * n - 3)):
+                print(f"    {GREEN}Test {i} ({plan}) passed.{BLACK}")
+            else:
+                print(f"    {RED}Test {i} ({plan}) failed.{BLACK}")
+                exit(1)
+
+        # plans of large arrays cannot be replayed here, they are checked by the verifier of the program
+        n = 100000
+        data = np.random.randint(-1000000, 1000000, n, dtype=np.int32)
+        data.tofile(os.path.join(TEST_FILES_DIR, filename))
+        os.system(f"file={filename}; ./main -t 4 -i {TEST_FILES_DIR}/$file -o {RESULT_FILES_DIR}/$file --reversal-plan {plan}")
+        status = os.system(f"file={filename}; ./main -t 4 -i {TEST_FILES_DIR}/$file -o {RESULT_FILES_DIR}/verified.txt --verify {RESULT_FILES_DIR}/$file 2>/dev/null")
+        with open(f"{RESULT_FILES_DIR}/verified.txt", "r") as f:
+            verified = f.read().strip()
+        if status == 0 and verified == "sorted":
+            print(f"    {GREEN}Verification of {n} elements ({plan}) passed.{BLACK}")
+        else:
+            print(f"    {RED}Verification of {n} elements ({plan}) failed.{BLACK} Got: {verified}")
             exit(1)
-        
-        for command in commands:
-            data[:command] = np.flip(data[:command])
-        
-        if np.all(data[:-1] <= data[1:]): # verify that the array is sorted
-            print(f"    {GREEN}Test {i} passed.{BLACK}")
+
+        # the compact format decodes to the same plan and is about 4 (insertion) or 3 (selection) times smaller
+        os.system(f"file={filename}; ./main -t 4 -i {TEST_FILES_DIR}/$file -o {RESULT_FILES_DIR}/compact.bin --reversal-plan {plan} --plan-format compact")
+        status = os.system(f"file={filename}; ./main -t 4 -i {TEST_FILES_DIR}/$file -o {RESULT_FILES_DIR}/verified.txt --verify {RESULT_FILES_DIR}/compact.bin 2>/dev/null")
+        with open(f"{RESULT_FILES_DIR}/verified.txt", "r") as f:
+            verified = f.read().strip()
+        rawBytes = os.path.getsize(f"{RESULT_FILES_DIR}/{filename}")
+        compactBytes = os.path.getsize(f"{RESULT_FILES_DIR}/compact.bin")
+        if status == 0 and verified == "sorted" and {"insertion": 4, "selection": 2.5}[plan] * compactBytes < rawBytes:
+            print(f"    {GREEN}Compact plan of {n} elements ({plan}) passed.{BLACK} {rawBytes} B raw, {compactBytes} B compact")
         else:
-            print(f"    {RED}Test {i} failed.{BLACK}")
+            print(f"    {RED}Compact plan of {n} elements ({plan}) failed.{BLACK} Got: {verified}, {rawBytes} B raw, {compactBytes} B compact")
             exit(1)
-    
+
+    # the verifier must reject a plan, which does not sort the (last large) array
+    os.system(f"printf '' > {RESULT_FILES_DIR}/empty.bin")
+    status = os.system(f"file={filename}; ./main -t 4 -i {TEST_FILES_DIR}/$file -o {RESULT_FILES_DIR}/verified.txt --verify {RESULT_FILES_DIR}/empty.bin 2>/dev/null")
+    with open(f"{RESULT_FILES_DIR}/verified.txt", "r") as f:
+        verified = f.read().strip()
+    if status != 0 and verified == "unsorted":
+        print(f"    {GREEN}Verification of an empty plan passed.{BLACK}")
+    else:
+        print(f"    {RED}Verification of an empty plan failed.{BLACK} Got: {verified}")
+        exit(1)
+
     os.system(f"rm -rf {TEST_FILES_DIR}/{filename}")
 
 if __name__ == "__main__":
@@ -119,6 +455,13 @@ if __name__ == "__main__":
     test_assignment(1)
     test_assignment(2)
     test_assignment_3()
+    test_level_sums()
     test_assignment_4()
+    test_statistics()
+    test_dtypes()
+    test_nearest()
+    test_ranges()
+    test_incremental()
+    test_server()
 
     os.system(f"rm -rf {RESULT_FILES_DIR}")
\ No newline at end of file